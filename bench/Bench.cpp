@@ -0,0 +1,343 @@
+#include "base/Base.h"
+
+#include <argparse/argparse.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "CorpusGenerator.h"
+
+using JSON = nlohmann::json;
+
+using namespace metadumper;
+
+namespace fs = std::filesystem;
+
+// End-to-end benchmark: builds synthetic corpora with the system compiler, times whole cppmetadumper runs on them
+// (phases from --stats), checks the results against golden files and appends the rates to a results file.
+
+struct BenchOptions {
+    fs::path    mDumper;
+    std::string mCompiler;
+    fs::path    mWorkDir;
+    fs::path    mGoldenDir;
+    fs::path    mResultsFile;
+    bool        mUpdateGolden{};
+    unsigned    mRepeat{};
+    double      mScale{};
+
+    std::vector<bench::CorpusShape> mShapes;
+};
+
+// Each one stresses a different part of the reader, see the README.
+std::vector<bench::CorpusShape> get_presets() {
+    std::vector<bench::CorpusShape> ret(6);
+    ret[0] = {.mName = "flat", .mClasses = 4000, .mMaxDepth = 1};
+    ret[1] = {.mName = "deep", .mClasses = 2000, .mMaxDepth = 24};
+    ret[2] = {.mName = "multiple", .mClasses = 2000, .mMaxDepth = 6, .mMultiple = 40};
+    ret[3] = {.mName = "virtual", .mClasses = 2000, .mMaxDepth = 6, .mMultiple = 40, .mVirtual = 50};
+    ret[4] = {.mName = "abstract", .mClasses = 2000, .mMaxDepth = 4, .mAbstract = 40};
+    ret[5] = {.mName = "large", .mClasses = 20000, .mMaxDepth = 8, .mMultiple = 10, .mVirtual = 10, .mAbstract = 10};
+    return ret;
+}
+
+BenchOptions init_program(int argc, char* argv[]) {
+    argparse::ArgumentParser args("cppmetadumper-bench", "1.0.0");
+
+    // clang-format off
+
+    args.add_argument("--dumper")
+        .help("Path to cppmetadumper, the one next to this benchmark by default.");
+    args.add_argument("--cxx")
+        .help("C++ compiler building the corpora, $CXX or c++ by default.");
+    args.add_argument("--work-dir")
+        .help("Directory for the generated sources, libraries and outputs.")
+        .default_value(std::string("bench-work"));
+    args.add_argument("--golden-dir")
+        .help("Directory of the golden files.")
+        .default_value(std::string("bench/golden"));
+    args.add_argument("--update-golden")
+        .help("Record the outputs as the new golden files instead of checking them.")
+        .default_value(false)
+        .implicit_value(true);
+    args.add_argument("--results")
+        .help("Append one JSON line per run to this file.")
+        .default_value(std::string("bench-results.ndjson"));
+    args.add_argument("--repeat")
+        .help("Runs per library, the fastest one is kept.")
+        .default_value(3)
+        .scan<'i', int>();
+    args.add_argument("--scale")
+        .help("Multiply the class counts of the presets.")
+        .default_value(1.0)
+        .scan<'g', double>();
+    args.add_argument("--case")
+        .help("Preset to run: flat, deep, multiple, virtual, abstract or large. Repeatable, all by default.")
+        .append();
+    args.add_argument("--classes")
+        .help("Run a custom shape with this many classes instead of the presets.")
+        .scan<'i', int>();
+    args.add_argument("--max-depth")
+        .help("Custom shape: maximum depth of inheritance.")
+        .default_value(4)
+        .scan<'i', int>();
+    args.add_argument("--methods")
+        .help("Custom shape: virtual methods declared per class.")
+        .default_value(4)
+        .scan<'i', int>();
+    args.add_argument("--multiple")
+        .help("Custom shape: percentage of classes with two direct bases.")
+        .default_value(0)
+        .scan<'i', int>();
+    args.add_argument("--virtual")
+        .help("Custom shape: percentage of bases inherited virtually.")
+        .default_value(0)
+        .scan<'i', int>();
+    args.add_argument("--abstract")
+        .help("Custom shape: percentage of classes with a pure virtual method.")
+        .default_value(0)
+        .scan<'i', int>();
+
+    // clang-format on
+
+    args.parse_args(argc, argv);
+
+    BenchOptions options;
+    options.mDumper       = args.present<std::string>("--dumper").value_or(
+        (fs::path(argv[0]).parent_path() / "cppmetadumper").string()
+    );
+    options.mWorkDir      = args.get<std::string>("--work-dir");
+    options.mGoldenDir    = args.get<std::string>("--golden-dir");
+    options.mResultsFile  = args.get<std::string>("--results");
+    options.mUpdateGolden = args.get<bool>("--update-golden");
+    options.mRepeat       = (unsigned)std::max(args.get<int>("--repeat"), 1);
+    options.mScale        = std::max(args.get<double>("--scale"), 0.0);
+
+    auto cxx          = std::getenv("CXX");
+    options.mCompiler = args.present<std::string>("--cxx").value_or(cxx ? cxx : "c++");
+
+    if (auto classes = args.present<int>("--classes")) {
+        options.mShapes.emplace_back(bench::CorpusShape{
+            .mName     = "custom",
+            .mClasses  = (unsigned)std::max(*classes, 1),
+            .mMaxDepth = (unsigned)std::max(args.get<int>("--max-depth"), 0),
+            .mMethods  = (unsigned)std::max(args.get<int>("--methods"), 0),
+            .mMultiple = (unsigned)std::clamp(args.get<int>("--multiple"), 0, 100),
+            .mVirtual  = (unsigned)std::clamp(args.get<int>("--virtual"), 0, 100),
+            .mAbstract = (unsigned)std::clamp(args.get<int>("--abstract"), 0, 100)
+        });
+        return options;
+    }
+
+    auto cases = args.present<std::vector<std::string>>("--case");
+    for (auto& shape : get_presets()) {
+        if (cases && std::find(cases->begin(), cases->end(), shape.mName) == cases->end()) continue;
+        shape.mClasses = std::max(1u, (unsigned)(shape.mClasses * options.mScale));
+        options.mShapes.emplace_back(shape);
+    }
+    if (options.mShapes.empty()) throw std::runtime_error("--case: no such preset.");
+    return options;
+}
+
+void init_logger() {
+    auto logger = spdlog::stdout_color_st("cppmetadumper-bench");
+    logger->set_pattern("[%T.%e %^%l%$] %v");
+    spdlog::set_default_logger(logger);
+}
+
+std::string quote(const fs::path& pPath) { return "\"" + pPath.string() + "\""; }
+
+std::optional<JSON> load_json(const fs::path& pPath) {
+    std::ifstream file(pPath);
+    if (!file.is_open()) return std::nullopt;
+    try {
+        return JSON::parse(file);
+    } catch (const JSON::exception&) {
+        return std::nullopt;
+    }
+}
+
+bool save_json(const fs::path& pPath, const JSON& pJson) {
+    std::ofstream file(pPath, std::ios::trunc);
+    file << std::setw(4) << pJson;
+    return file.good();
+}
+
+// Only rebuilt when the generated source changed.
+bool build_library(const BenchOptions& pOptions, const fs::path& pSource, const fs::path& pOutput, bool pStripped) {
+    std::error_code error;
+    if (fs::exists(pOutput, error) && fs::last_write_time(pOutput, error) >= fs::last_write_time(pSource, error)) {
+        return true;
+    }
+    // Without symbols: hidden visibility leaves nothing but bench_create() in .dynsym, then .symtab is stripped.
+    auto command = fmt::format(
+        "{} -std=c++17 -O2 -shared -fPIC {}-o {} {}",
+        pOptions.mCompiler,
+        pStripped ? "-fvisibility=hidden -s " : "",
+        quote(pOutput),
+        quote(pSource)
+    );
+    spdlog::info("{:<12}{}", "Compiling:", pOutput.filename().string());
+    if (std::system(command.c_str()) != 0) {
+        spdlog::error("Failed to compile {}.", pSource.string());
+        fs::remove(pOutput, error);
+        return false;
+    }
+    return true;
+}
+
+// Addresses depend on the compiler and its version, names and layouts only on the ABI.
+JSON normalize(JSON pVFTable, JSON pTypeInfo) {
+    for (auto& [name, table] : pVFTable.items()) {
+        for (auto& subTable : table["sub_tables"]) {
+            for (auto& entity : subTable["entities"]) entity.erase("rva");
+        }
+    }
+    return JSON{
+        {"vftable",  std::move(pVFTable) },
+        {"typeinfo", std::move(pTypeInfo)}
+    };
+}
+
+// "ok", "mismatch" or "missing", "recorded" or "unrecorded" with --update-golden. A missing golden file fails the
+// run, recording it silently would accept whatever the current output is, regressions included.
+std::string check_golden(const BenchOptions& pOptions, const std::string& pName, const JSON& pResult) {
+    auto path = pOptions.mGoldenDir / (pName + ".json");
+    if (!pOptions.mUpdateGolden) {
+        auto golden = load_json(path);
+        if (!golden) {
+            spdlog::error(
+                "No golden file for {} at {}, review the output and record it with --update-golden.",
+                pName,
+                path.string()
+            );
+            return "missing";
+        }
+        if (*golden == pResult) return "ok";
+        auto diff = JSON::diff(*golden, pResult);
+        spdlog::error("{} differs from {} in {} place(s), e.g.:", pName, path.string(), diff.size());
+        for (size_t idx = 0; idx < std::min<size_t>(diff.size(), 5); idx++) spdlog::error("  {}", diff[idx].dump());
+        return "mismatch";
+    }
+    std::error_code error;
+    fs::create_directories(pOptions.mGoldenDir, error);
+    if (!save_json(path, pResult)) {
+        spdlog::error("Failed to write {}!", path.string());
+        return "unrecorded";
+    }
+    return "recorded";
+}
+
+// Returns false if the run failed or the output doesn't match its golden file, or there is none.
+bool run_case(const BenchOptions& pOptions, const bench::CorpusGenerator& pCorpus, bool pStripped) {
+    auto& shape   = pCorpus.getShape();
+    auto  name    = shape.mName + (pStripped ? ".stripped" : ".symbols");
+    auto  dir     = pOptions.mWorkDir / shape.mName;
+    auto  source  = dir / (shape.mName + ".cpp");
+    auto  library = dir / ("lib" + name + ".so");
+    auto  output  = dir / name;
+
+    if (!build_library(pOptions, source, library, pStripped)) return false;
+
+    // The fastest of the runs.
+    std::optional<JSON> best;
+    for (unsigned run = 0; run < pOptions.mRepeat; run++) {
+        auto statsFile = output.string() + ".stats.json";
+        auto command   = fmt::format(
+            "{} {} -o {} --stats {} > {} 2>&1",
+            quote(pOptions.mDumper),
+            quote(library),
+            quote(output.string() + ".json"),
+            quote(statsFile),
+            quote(output.string() + ".log")
+        );
+        if (std::system(command.c_str()) != 0) {
+            spdlog::error("cppmetadumper failed on {}, see {}.log", library.string(), output.string());
+            return false;
+        }
+        auto stats = load_json(statsFile);
+        if (!stats) {
+            spdlog::error("Failed to read {}.", statsFile);
+            return false;
+        }
+        if (!best || (*stats)["total_seconds"] < (*best)["total_seconds"]) best = std::move(stats);
+    }
+
+    auto vftable  = load_json(output.string() + ".vftable.json").value_or(JSON::object());
+    auto typeinfo = load_json(output.string() + ".typeinfo.json").value_or(JSON::object());
+
+    size_t found = 0;
+    auto   names = pCorpus.getTypeInfoNames();
+    for (auto& typeName : names) found += typeinfo.contains(typeName);
+
+    auto golden = check_golden(pOptions, name, normalize(vftable, typeinfo));
+
+    spdlog::info(
+        "{:<20}{:>8} classes/s {:>8.2f} MB/s {:>10.3f} ms  {}/{} classes  golden: {}",
+        name,
+        (*best)["classes_per_second"].is_number() ? (uint64_t)(*best)["classes_per_second"].get<double>() : 0,
+        (*best)["mb_per_second"].is_number() ? (*best)["mb_per_second"].get<double>() : 0.0,
+        (*best)["total_seconds"].get<double>() * 1000.0,
+        found,
+        names.size(),
+        golden
+    );
+
+    auto now    = std::chrono::system_clock::now().time_since_epoch();
+    JSON record = *best;
+    record["case"]      = name;
+    record["shape"]     = shape.toJson();
+    record["stripped"]  = pStripped;
+    record["expected"]  = names.size();
+    record["found"]     = found;
+    record["golden"]    = golden;
+    record["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(now).count();
+
+    std::ofstream results(pOptions.mResultsFile, std::ios::app);
+    results << record.dump() << '\n';
+    if (!results.good()) spdlog::error("Failed to write {}!", pOptions.mResultsFile.string());
+
+    return golden == "ok" || golden == "recorded";
+}
+
+int main(int argc, char* argv[]) {
+    init_logger();
+
+    BenchOptions options;
+    try {
+        options = init_program(argc, argv);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        return -1;
+    }
+
+    std::error_code error;
+    if (!fs::exists(options.mDumper, error)) {
+        spdlog::error("cppmetadumper not found at {}, see --dumper.", options.mDumper.string());
+        return -1;
+    }
+
+    bool isPassed = true;
+    for (auto& shape : options.mShapes) {
+        bench::CorpusGenerator corpus(shape);
+
+        auto dir    = options.mWorkDir / shape.mName;
+        auto source = dir / (shape.mName + ".cpp");
+        fs::create_directories(dir, error);
+
+        // Rewritten only if changed, which keeps the libraries built.
+        auto               text = corpus.generate();
+        std::ostringstream current;
+        current << std::ifstream(source).rdbuf();
+        if (current.str() != text) std::ofstream(source, std::ios::trunc) << text;
+
+        isPassed &= run_case(options, corpus, false);
+        isPassed &= run_case(options, corpus, true);
+    }
+
+    spdlog::info("Results have been appended to: {}", options.mResultsFile.string());
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "CorpusGenerator.h"
+
+#include <algorithm>
+#include <sstream>
+
+METADUMPER_BENCH_BEGIN
+
+nlohmann::json CorpusShape::toJson() const {
+    return nlohmann::json{
+        {"name",      mName    },
+        {"classes",   mClasses },
+        {"max_depth", mMaxDepth},
+        {"methods",   mMethods },
+        {"multiple",  mMultiple},
+        {"virtual",   mVirtual },
+        {"abstract",  mAbstract},
+        {"seed",      mSeed    }
+    };
+}
+
+CorpusGenerator::CorpusGenerator(CorpusShape pShape) : mShape(std::move(pShape)), mState(mShape.mSeed) {
+    mClasses.resize(mShape.mClasses);
+    for (uint32_t idx = 0; idx < mShape.mClasses; idx++) {
+        auto& cls = mClasses[idx];
+        // Roots start new trees, one in eight classes.
+        if (idx && mShape.mMaxDepth && _next() % 8) {
+            if (auto base = _pickBase(idx)) cls.mBases.emplace_back(*base);
+        }
+        if (!cls.mBases.empty() && _chance(mShape.mMultiple)) {
+            // Neither base may derive from the other, the second one would be inaccessible.
+            auto& first = mClasses[cls.mBases[0]].mAncestors;
+            for (int tries = 0; tries < 8; tries++) {
+                auto base = _pickBase(idx);
+                if (!base || std::binary_search(first.begin(), first.end(), *base)) continue;
+                auto& second = mClasses[*base].mAncestors;
+                if (std::binary_search(second.begin(), second.end(), cls.mBases[0])) continue;
+                cls.mBases.emplace_back(*base);
+                break;
+            }
+        }
+        cls.mAncestors.emplace_back(idx);
+        for (auto base : cls.mBases) {
+            auto& baseClass = mClasses[base];
+            cls.mIsVirtualBase.emplace_back(_chance(mShape.mVirtual));
+            cls.mDepth = std::max(cls.mDepth, baseClass.mDepth + 1);
+            cls.mAncestors.insert(cls.mAncestors.end(), baseClass.mAncestors.begin(), baseClass.mAncestors.end());
+        }
+        std::sort(cls.mAncestors.begin(), cls.mAncestors.end());
+        cls.mAncestors.erase(std::unique(cls.mAncestors.begin(), cls.mAncestors.end()), cls.mAncestors.end());
+        cls.mIsAbstract = mShape.mMethods && _chance(mShape.mAbstract);
+    }
+}
+
+std::string CorpusGenerator::generate() const {
+    auto methodName = [](uint32_t pClass, unsigned int pMethod) { return fmt::format("f{}_{}", pClass, pMethod); };
+
+    std::ostringstream out;
+    out << "// Generated by cppmetadumper-bench: " << mShape.toJson().dump() << "\n\n";
+
+    // Declarations, bases always come first.
+    std::vector<std::vector<std::pair<uint32_t, unsigned int>>> overrides(mClasses.size());
+    for (uint32_t idx = 0; idx < mClasses.size(); idx++) {
+        auto& cls = mClasses[idx];
+        out << "struct C" << idx;
+        for (size_t base = 0; base < cls.mBases.size(); base++) {
+            out << (base ? ", " : " : ") << (cls.mIsVirtualBase[base] ? "virtual public C" : "public C")
+                << cls.mBases[base];
+        }
+        out << " {\n";
+        if (cls.mBases.empty()) out << "    virtual ~C" << idx << "();\n";
+        else out << "    ~C" << idx << "() override;\n";
+
+        auto& overridden = overrides[idx];
+        if (mShape.mMethods) {
+            for (auto base : cls.mBases) overridden.emplace_back(base, 0);
+        }
+        for (auto ancestor : _getSharedAncestors(cls)) {
+            for (unsigned int method = 0; method < mShape.mMethods; method++) overridden.emplace_back(ancestor, method);
+        }
+        std::sort(overridden.begin(), overridden.end());
+        overridden.erase(std::unique(overridden.begin(), overridden.end()), overridden.end());
+        for (auto& [ancestor, method] : overridden) {
+            out << "    int " << methodName(ancestor, method) << "() override;\n";
+        }
+
+        for (unsigned int method = 0; method < mShape.mMethods; method++) {
+            out << "    virtual int " << methodName(idx, method) << "()" << (!method && cls.mIsAbstract ? " = 0" : "")
+                << ";\n";
+        }
+        out << "};\n\n";
+    }
+
+    // Definitions, out of line as in most code bases. Distinct bodies, so identical code folding keeps every slot.
+    unsigned int value = 0;
+    for (uint32_t idx = 0; idx < mClasses.size(); idx++) {
+        out << "C" << idx << "::~C" << idx << "() = default;\n";
+        for (auto& [ancestor, method] : overrides[idx]) {
+            out << "int C" << idx << "::" << methodName(ancestor, method) << "() { return " << value++ << "; }\n";
+        }
+        for (unsigned int method = mClasses[idx].mIsAbstract ? 1 : 0; method < mShape.mMethods; method++) {
+            out << "int C" << idx << "::" << methodName(idx, method) << "() { return " << value++ << "; }\n";
+        }
+    }
+
+    out << "\nextern \"C\" __attribute__((visibility(\"default\"))) void* bench_create(int pId) {\n";
+    out << "    switch (pId) {\n";
+    for (uint32_t idx = 0; idx < mClasses.size(); idx++) {
+        if (mClasses[idx].mIsAbstract) continue;
+        out << "    case " << idx << ":\n        return new C" << idx << ";\n";
+    }
+    out << "    default:\n        return nullptr;\n    }\n}\n";
+    return out.str();
+}
+
+std::vector<std::string> CorpusGenerator::getTypeInfoNames() const {
+    std::vector<std::string> ret;
+    ret.reserve(mClasses.size());
+    for (uint32_t idx = 0; idx < mClasses.size(); idx++) {
+        auto name = "C" + std::to_string(idx);
+        ret.emplace_back("_ZTI" + std::to_string(name.size()) + name);
+    }
+    return ret;
+}
+
+uint64_t CorpusGenerator::_next() {
+    // splitmix64
+    auto value = (mState += 0x9e3779b97f4a7c15);
+    value      = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value      = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+}
+
+std::optional<uint32_t> CorpusGenerator::_pickBase(uint32_t pCount) {
+    for (int tries = 0; tries < 8; tries++) {
+        // Half of the time one of the last classes, which builds long chains.
+        auto base = (uint32_t)(_next() % pCount);
+        if (_next() % 2) base = pCount - 1 - (uint32_t)(_next() % std::min(pCount, 16u));
+        if (mClasses[base].mDepth < mShape.mMaxDepth) return base;
+    }
+    return std::nullopt;
+}
+
+std::vector<uint32_t> CorpusGenerator::_getSharedAncestors(const Class& pClass) const {
+    if (pClass.mBases.size() < 2) return {};
+    auto& first  = mClasses[pClass.mBases[0]].mAncestors;
+    auto& second = mClasses[pClass.mBases[1]].mAncestors;
+    std::vector<uint32_t> ret;
+    std::set_intersection(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(ret));
+    return ret;
+}
+
+METADUMPER_BENCH_END
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <nlohmann/json.hpp>
+
+#include <optional>
+
+METADUMPER_BENCH_BEGIN
+
+// Size and shape of a synthetic class hierarchy. Percentages are of the generated classes.
+struct CorpusShape {
+    std::string  mName;
+    unsigned int mClasses{1000};
+    unsigned int mMaxDepth{4}; // of the inheritance chains, 0 for no inheritance at all.
+    unsigned int mMethods{4};  // new virtual methods declared by every class.
+    unsigned int mMultiple{};  // classes with a second direct base.
+    unsigned int mVirtual{};   // direct bases inherited virtually.
+    unsigned int mAbstract{};  // classes declaring a pure virtual method.
+    uint64_t     mSeed{0x5eed};
+
+    [[nodiscard]] nlohmann::json toJson() const;
+};
+
+// Generates one translation unit of polymorphic classes C0..Cn for a shape. The output only depends on the shape (no
+// <random>, whose distributions differ between standard libraries), so the same corpus is built everywhere.
+//
+// Every class overrides the first method of its direct bases, which makes derived classes of abstract ones concrete,
+// and all methods of ancestors reachable through more than one base, so a final overrider always exists. Concrete
+// classes are instantiated by an exported `bench_create()`, which keeps their vtables alive in stripped builds.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(CorpusShape pShape);
+
+    [[nodiscard]] std::string generate() const;
+
+    [[nodiscard]] const CorpusShape& getShape() const { return mShape; }
+
+    // Mangled names, as keys of the typeinfo output.
+    [[nodiscard]] std::vector<std::string> getTypeInfoNames() const;
+
+private:
+    struct Class {
+        std::vector<uint32_t> mBases;
+        std::vector<bool>     mIsVirtualBase;
+        std::vector<uint32_t> mAncestors; // sorted, itself included.
+        unsigned int          mDepth{};
+        bool                  mIsAbstract{};
+    };
+
+    uint64_t _next();
+    bool     _chance(unsigned int pPercent) { return _next() % 100 < pPercent; }
+    // A class of depth lower than the maximum, or nullopt.
+    std::optional<uint32_t> _pickBase(uint32_t pCount);
+
+    // Classes whose methods are all overridden by pClass.
+    [[nodiscard]] std::vector<uint32_t> _getSharedAncestors(const Class& pClass) const;
+
+    CorpusShape        mShape;
+    uint64_t           mState;
+    std::vector<Class> mClasses;
+};
+
+METADUMPER_BENCH_END
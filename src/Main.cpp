@@ -1,19 +1,71 @@
 #include "base/Base.h"
 
 #include <argparse/argparse.hpp>
-#include <fstream>
+#include <filesystem>
+#include <iomanip>
 
-#include "format/ELF.h"
-#include "format/MachO.h"
-#include "util/MagicHelper.h"
+#include "api/Image.h"
 
-#include "abi/itanium/ItaniumVTableReader.h"
+#include "abi/itanium/ItaniumSlotIndex.h"
+#include "abi/itanium/ItaniumTypeHierarchy.h"
+
+#include "format/DependencyScope.h"
+
+#include "output/HeaderWriter.h"
+#include "output/JSONObjectWriter.h"
+#include "output/NDJSONWriter.h"
+#include "output/OutputFile.h"
+#include "output/RecordStore.h"
+#include "output/SQLiteWriter.h"
+#include "output/ShardWriter.h"
+#include "server/QueryServer.h"
+
+#include "util/MemoryUsage.h"
+#include "util/PhaseStats.h"
 
 using JSON = nlohmann::json;
 
 using namespace metadumper;
 
-std::tuple<std::string, std::string> init_program(int argc, char* argv[]) {
+struct ProgramOptions {
+    std::string mInputFile;
+    std::string mOutputFile;
+    bool        mServe{};
+    std::string mSocketPath;
+    bool        mNDJSON{};
+    bool        mSQLite{};
+    bool        mHeader{};
+    std::string mHeaderNamespace;
+    size_t      mMemoryBudget{}; // bytes, 0 = unlimited.
+    std::string mStorePath;
+    std::string mStatsFile;
+    bool        mPerfCounters{};
+
+    abi::itanium::VTableLimits mLimits;
+
+    std::optional<format::DependencyScope::Options> mDependencies;
+
+    std::optional<output::ShardOptions> mShard;
+};
+
+// e.g. "metadump" or "game::offsets".
+bool is_namespace(std::string_view pName) {
+    bool first = true;
+    for (size_t idx = 0; idx <= pName.size(); idx++) {
+        if (idx == pName.size() || pName.substr(idx).starts_with("::")) {
+            if (first) return false; // empty component.
+            first = true;
+            idx++;
+            continue;
+        }
+        auto c = pName[idx];
+        if (!(std::isalpha((unsigned char)c) || c == '_' || (!first && std::isdigit((unsigned char)c)))) return false;
+        first = false;
+    }
+    return true;
+}
+
+ProgramOptions init_program(int argc, char* argv[]) {
     argparse::ArgumentParser args("cppmetadumper", "2.0.0");
 
     // clang-format off
@@ -22,18 +74,141 @@ std::tuple<std::string, std::string> init_program(int argc, char* argv[]) {
         .help("Path to a valid executable.")
         .required();
     args.add_argument("-o", "--output")
-        .help("Path to save the result, in JSON format.")
-        .required();
+        .help("Path to save the result, in JSON format. Add .gz or .zst to compress it.");
+    args.add_argument("--format")
+        .help("Output format: json, ndjson (one record per line), sqlite (indexed tables) or header (C++ constexpr).")
+        .default_value(std::string("json"));
+    args.add_argument("--header-namespace")
+        .help("Namespace of the generated header, for --format header.")
+        .default_value(std::string("metadump"));
+    args.add_argument("--serve")
+        .help("Keep the image loaded and answer JSON-RPC requests (stdin/stdout by default).")
+        .default_value(false)
+        .implicit_value(true);
+    args.add_argument("--socket")
+        .help("Serve on a unix socket at this path instead of stdin/stdout.");
+    args.add_argument("--memory-budget")
+        .help("Memory budget in MiB for reading the image and writing JSON, the input must fit. Warns if exceeded.")
+        .default_value(0)
+        .scan<'i', int>();
+    args.add_argument("--max-slots")
+        .help("Skip vtables with more slots than this, e.g. runaway reads of corrupted tables.")
+        .default_value((int)abi::itanium::VTableLimits{}.mMaxSlots)
+        .scan<'i', int>();
+    args.add_argument("--max-sub-tables")
+        .help("Skip vtables with more sub tables than this.")
+        .default_value((int)abi::itanium::VTableLimits{}.mMaxSubTables)
+        .scan<'i', int>();
+    args.add_argument("--library-path")
+        .help("Directory to search for DT_NEEDED dependencies, resolving external slots to their library. Repeatable.")
+        .append();
+    args.add_argument("--sysroot")
+        .help("Root of the target file system, to search for dependencies in its lib directories.");
+    args.add_argument("--store")
+        .help("Add the results to a deduplicated record store in this directory, instead of -o.");
+    args.add_argument("--shard-by")
+        .help("Split the results into shard files plus a manifest: namespace, prefix or count.");
+    args.add_argument("--shards")
+        .help("Number of shards per result, for --shard-by count.")
+        .default_value(16)
+        .scan<'i', int>();
+    args.add_argument("--shard-prefix")
+        .help("Length of the name prefix, for --shard-by prefix.")
+        .default_value(1)
+        .scan<'i', int>();
+    args.add_argument("--stats")
+        .help("Time every phase of the run and save the report to this path, in JSON format.");
+    args.add_argument("--perf-counters")
+        .help("Add hardware counters (cycles, instructions, cache and branch misses, page faults) to --stats.")
+        .default_value(false)
+        .implicit_value(true);
 
     // clang-format on
 
     args.parse_args(argc, argv);
 
-    return std::make_tuple(args.get<std::string>("target"), args.get<std::string>("-o"));
+    ProgramOptions options;
+    options.mInputFile  = args.get<std::string>("target");
+    options.mOutputFile = args.present<std::string>("-o").value_or("");
+    options.mServe      = args.get<bool>("--serve");
+    options.mSocketPath = args.present<std::string>("--socket").value_or("");
+    options.mStorePath  = args.present<std::string>("--store").value_or("");
+    options.mStatsFile  = args.present<std::string>("--stats").value_or("");
+
+    options.mPerfCounters = args.get<bool>("--perf-counters");
+
+    if (!options.mStorePath.empty() && !options.mOutputFile.empty()) {
+        throw std::runtime_error("--store: can't be used with -o.");
+    }
+    if (!options.mServe && options.mStorePath.empty() && options.mOutputFile.empty()) {
+        throw std::runtime_error("-o: required.");
+    }
+    if (options.mServe && !options.mStatsFile.empty()) {
+        throw std::runtime_error("--stats: can't be used with --serve.");
+    }
+    if (options.mPerfCounters && options.mStatsFile.empty()) {
+        throw std::runtime_error("--perf-counters: requires --stats.");
+    }
+
+    auto format = args.get<std::string>("--format");
+    if (format != "json" && format != "ndjson" && format != "sqlite" && format != "header") {
+        throw std::runtime_error("--format: must be json, ndjson, sqlite or header.");
+    }
+    options.mNDJSON = format == "ndjson";
+    options.mSQLite = format == "sqlite";
+    options.mHeader = format == "header";
+
+    options.mHeaderNamespace = args.get<std::string>("--header-namespace");
+    if (!is_namespace(options.mHeaderNamespace)) {
+        throw std::runtime_error("--header-namespace: must be a C++ namespace, e.g. game::offsets.");
+    }
+
+    options.mMemoryBudget = (size_t)std::max(args.get<int>("--memory-budget"), 0) * 1024 * 1024;
+
+    options.mLimits.mMaxSlots     = (unsigned int)std::max(args.get<int>("--max-slots"), 1);
+    options.mLimits.mMaxSubTables = (unsigned int)std::max(args.get<int>("--max-sub-tables"), 1);
+
+    auto libraryPaths = args.present<std::vector<std::string>>("--library-path");
+    auto sysroot      = args.present<std::string>("--sysroot");
+    if (libraryPaths || sysroot) {
+        options.mDependencies = format::DependencyScope::Options{
+            sysroot.value_or(""),
+            libraryPaths.value_or(std::vector<std::string>{})
+        };
+    }
+
+    if (auto shardBy = args.present<std::string>("--shard-by")) {
+        auto mode = output::parseShardMode(*shardBy);
+        if (!mode) throw std::runtime_error("--shard-by: must be namespace, prefix or count.");
+        options.mShard = output::ShardOptions{
+            *mode,
+            (size_t)std::max(args.get<int>("--shards"), 1),
+            (size_t)std::max(args.get<int>("--shard-prefix"), 1)
+        };
+    }
+
+    // Both build their whole results in memory.
+    if (options.mMemoryBudget && !options.mStorePath.empty()) {
+        throw std::runtime_error("--memory-budget: can't be used with --store.");
+    }
+    if (options.mMemoryBudget && options.mShard) {
+        throw std::runtime_error("--memory-budget: can't be used with --shard-by.");
+    }
+
+    if ((options.mNDJSON || options.mSQLite || options.mHeader) && options.mShard) {
+        throw std::runtime_error(fmt::format("--format {}: can't be used with --shard-by.", format));
+    }
+    if ((options.mSQLite || options.mHeader)
+        && output::detectCompression(options.mOutputFile) != output::Compression::None) {
+        throw std::runtime_error(fmt::format("--format {}: can't be compressed.", format));
+    }
+
+    return options;
 }
 
-void init_logger() {
-    auto logger = spdlog::stdout_color_st("cppmetadumper");
+void init_logger(bool pToStderr = false) {
+    // In serve mode stdout belongs to the JSON-RPC stream, and connections are handled by multiple threads.
+    auto logger = pToStderr ? spdlog::stderr_color_mt("cppmetadumper-serve") : spdlog::stdout_color_st("cppmetadumper");
     logger->set_pattern("[%T.%e %^%l%$] %v");
 #ifndef NDEBUG
     logger->set_level(spdlog::level::debug);
@@ -41,34 +216,209 @@ void init_logger() {
     spdlog::set_default_logger(logger);
 }
 
-JSON read_vtable(abi::itanium::ItaniumVTableReader& reader) {
+void print_parsed(std::string_view kind, unsigned int parsed, unsigned int total) {
+    spdlog::info("Parsed {}(s): {}/{}({:.4}%)", kind, parsed, total, ((double)parsed / (double)total) * 100.0);
+}
+
+abi::itanium::DumpVFTableResult read_vtable(abi::itanium::ItaniumVTableReader& reader, util::PhaseStats& stats) {
+    stats.begin("vftable");
     auto vftable = reader.dumpVFTable();
-    spdlog::info(
-        "Parsed vftable(s): {}/{}({:.4}%)",
-        vftable.mParsed,
-        vftable.mTotal,
-        ((double)vftable.mParsed / (double)vftable.mTotal) * 100.0
-    );
-    return vftable.toJson();
+    print_parsed("vftable", vftable.mParsed, vftable.mTotal);
+    stats.count("vftables", vftable.mParsed);
+    return vftable;
 }
 
-JSON read_typeinfo(abi::itanium::ItaniumVTableReader& reader) {
+abi::itanium::DumpTypeInfoResult read_typeinfo(abi::itanium::ItaniumVTableReader& reader, util::PhaseStats& stats) {
+    stats.begin("typeinfo");
     auto types = reader.dumpTypeInfo();
-    spdlog::info(
-        "Parsed typeinfo(s): {}/{}({:.4}%)",
-        types.mParsed,
-        types.mTotal,
-        ((double)types.mParsed / (double)types.mTotal) * 100.0
-    );
-    return types.toJson();
+    print_parsed("typeinfo", types.mParsed, types.mTotal);
+    stats.count("typeinfos", types.mParsed);
+    return types;
+}
+
+// Indices of pCount entries sorted by name, keeping the last of duplicate names: the entries of a JSON object built
+// by assigning them in order.
+template <typename GetName>
+std::vector<uint32_t> sort_by_name(size_t pCount, GetName&& pGetName) {
+    std::vector<uint32_t> order(pCount);
+    for (uint32_t idx = 0; idx < pCount; idx++) order[idx] = idx;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t pLeft, uint32_t pRight) {
+        return pGetName(pLeft) < pGetName(pRight);
+    });
+    std::vector<uint32_t> ret;
+    for (size_t idx = 0; idx < order.size(); idx++) {
+        if (idx + 1 < order.size() && pGetName(order[idx]) == pGetName(order[idx + 1])) continue;
+        ret.emplace_back(order[idx]);
+    }
+    return ret;
+}
+
+// Entries are written one by one, in the same bytes as save_to_json() of the whole results. Vtables are decoded twice:
+// first for the slot index (which keeps their names) and where they begin, then again in name order to be written.
+abi::itanium::DumpTypeInfoResult stream_to_json(
+    abi::itanium::ItaniumVTableReader& reader,
+    abi::itanium::SlotIndex&           slots,
+    util::PhaseStats&                  stats,
+    const std::string&                 base,
+    const std::string&                 suffix
+) {
+    auto finish = [](output::JSONObjectWriter& writer, const std::string& fileName) {
+        if (!writer.finish()) throw std::runtime_error(fmt::format("Failed to write {}!", fileName));
+        if (writer.size()) spdlog::info("Results have been saved to: {}", fileName);
+    };
+
+    stats.begin("vftable");
+    std::vector<uintptr_t> begins; // of vtable i of the slot index.
+    auto                   vftable = reader.dumpVFTableBegins([&](uintptr_t begin, abi::itanium::VTable&& table) {
+        slots.add(table);
+        begins.emplace_back(begin);
+    });
+    print_parsed("vftable", vftable.mParsed, vftable.mTotal);
+    stats.count("vftables", vftable.mParsed);
+
+    stats.begin("typeinfo");
+    auto types = reader.dumpTypeInfo();
+    print_parsed("typeinfo", types.mParsed, types.mTotal);
+    stats.count("typeinfos", types.mParsed);
+
+    stats.begin("write");
+    auto getVTableName = [&](uint32_t pIndex) -> const std::string& { return slots.getVTableName(pIndex); };
+
+    auto                     vftableFile = base + ".vftable.json" + suffix;
+    output::JSONObjectWriter vftableWriter(vftableFile);
+    for (auto idx : sort_by_name(begins.size(), getVTableName)) {
+        if (auto table = reader.readVTableAt(begins[idx])) vftableWriter.add(table->mName, table->toJson());
+    }
+    finish(vftableWriter, vftableFile);
+
+    auto&                                      table = types.mTypeInfo;
+    std::vector<const abi::itanium::TypeInfo*> entries;
+    for (auto& type : table) entries.emplace_back(&type);
+    auto getTypeName = [&](uint32_t pIndex) -> const std::string& { return table.getName(entries[pIndex]->mName); };
+
+    auto                     typeinfoFile = base + ".typeinfo.json" + suffix;
+    output::JSONObjectWriter typeinfoWriter(typeinfoFile);
+    for (auto idx : sort_by_name(entries.size(), getTypeName)) {
+        typeinfoWriter.add(getTypeName(idx), table.toJson(*entries[idx]));
+    }
+    finish(typeinfoWriter, typeinfoFile);
+    return types;
+}
+
+// Same bytes as save_to_json() of pSource.toJson(), written array item by array item.
+template <typename Source>
+void stream_arrays_to_json(const std::string& fileName, const Source& pSource) {
+    output::JSONObjectWriter writer(fileName);
+    pSource.visitJson([&](const std::string& key, size_t size, const std::function<JSON(size_t)>& item) {
+        writer.addArray(key, size, item);
+    });
+    if (!writer.finish()) {
+        spdlog::error("Failed to write {}!", fileName);
+        return;
+    }
+    if (writer.size()) spdlog::info("Results have been saved to: {}", fileName);
+}
+
+// Decoding and writing overlap, only the typeinfos are kept (for the hierarchy).
+abi::itanium::DumpTypeInfoResult stream_to_ndjson(
+    abi::itanium::ItaniumVTableReader& reader,
+    abi::itanium::SlotIndex&           slots,
+    util::PhaseStats&                  stats,
+    const std::string&                 fileName
+) {
+    output::NDJSONWriter writer(fileName);
+    if (!writer.isValid()) throw std::runtime_error(fmt::format("Failed to open {}!", fileName));
+
+    stats.begin("vftable");
+    auto vftable = reader.dumpVFTable([&](abi::itanium::VTable&& table) {
+        slots.add(table);
+        writer.push(std::move(table));
+    });
+    print_parsed("vftable", vftable.mParsed, vftable.mTotal);
+    stats.count("vftables", vftable.mParsed);
+
+    stats.begin("typeinfo");
+    auto types = reader.dumpTypeInfo([&](const abi::itanium::TypeInfoTable& table, const abi::itanium::TypeInfo& type) {
+        writer.push(table, type);
+    });
+    print_parsed("typeinfo", types.mParsed, types.mTotal);
+    stats.count("typeinfos", types.mParsed);
+
+    stats.begin("write"); // what the writer thread has left.
+    if (!writer.finish()) throw std::runtime_error(fmt::format("Failed to write {}!", fileName));
+    spdlog::info("Results have been saved to: {}", fileName);
+    return types;
+}
+
+// Rows are inserted as entries are decoded, only the typeinfos are kept (for the hierarchy).
+abi::itanium::DumpTypeInfoResult stream_to_sqlite(
+    abi::itanium::ItaniumVTableReader& reader,
+    abi::itanium::SlotIndex&           slots,
+    util::PhaseStats&                  stats,
+    const std::string&                 fileName
+) {
+    output::SQLiteWriter writer(fileName);
+    if (!writer.isValid()) throw std::runtime_error(fmt::format("Failed to open {}!", fileName));
+
+    stats.begin("vftable");
+    auto vftable = reader.dumpVFTable([&](abi::itanium::VTable&& table) {
+        slots.add(table);
+        writer.add(table);
+    });
+    print_parsed("vftable", vftable.mParsed, vftable.mTotal);
+    stats.count("vftables", vftable.mParsed);
+
+    stats.begin("typeinfo");
+    auto types = reader.dumpTypeInfo([&](const abi::itanium::TypeInfoTable& table, const abi::itanium::TypeInfo& type) {
+        writer.add(table, type);
+    });
+    print_parsed("typeinfo", types.mParsed, types.mTotal);
+    stats.count("typeinfos", types.mParsed);
+
+    stats.begin("index");
+    if (!writer.finish()) throw std::runtime_error(fmt::format("Failed to write {}!", fileName));
+    spdlog::info("Results have been saved to: {}", fileName);
+    return types;
+}
+
+// Only the vtables go into the header, the typeinfos are kept for the hierarchy.
+abi::itanium::DumpTypeInfoResult stream_to_header(
+    abi::itanium::ItaniumVTableReader& reader,
+    abi::itanium::SlotIndex&           slots,
+    util::PhaseStats&                  stats,
+    const std::string&                 fileName,
+    const std::string&                 nameSpace
+) {
+    output::HeaderWriter writer(fileName, nameSpace);
+
+    stats.begin("vftable");
+    auto vftable = reader.dumpVFTable([&](abi::itanium::VTable&& table) {
+        slots.add(table);
+        writer.add(table);
+    });
+    print_parsed("vftable", vftable.mParsed, vftable.mTotal);
+    stats.count("vftables", vftable.mParsed);
+
+    stats.begin("typeinfo");
+    auto types = reader.dumpTypeInfo();
+    print_parsed("typeinfo", types.mParsed, types.mTotal);
+    stats.count("typeinfos", types.mParsed);
+
+    stats.begin("write"); // including the perfect hash.
+    if (!writer.finish()) throw std::runtime_error(fmt::format("Failed to write {}!", fileName));
+    spdlog::info("Results have been saved to: {}", fileName);
+    return types;
 }
 
 void save_to_json(const std::string& fileName, const JSON& result) {
     if (result.empty()) return;
-    std::ofstream file(fileName, std::ios::trunc);
-    if (file.is_open()) {
-        file << result.dump(4);
-        file.close();
+    output::OutputFile file(fileName);
+    if (file.isValid()) {
+        file.stream() << std::setw(4) << result;
+        if (!file.close()) {
+            spdlog::error("Failed to write {}!", fileName);
+            return;
+        }
         spdlog::info("Results have been saved to: {}", fileName);
     } else {
         spdlog::error("Failed to open {}!", fileName);
@@ -76,65 +426,166 @@ void save_to_json(const std::string& fileName, const JSON& result) {
     }
 }
 
+// The budget bounds the pages read from the image and the JSON output, not what LIEF allocates to parse the headers
+// and symbol tables: warns if the process went over it anyway. Returns false if it did.
+bool check_memory_budget(size_t budget, std::string_view phase) {
+    if (!budget) return true;
+    auto peak = util::getPeakResidentSize();
+    if (!peak || *peak <= budget) return true;
+    spdlog::warn(
+        "Peak resident memory after {} is {} MiB, over the budget of {} MiB.",
+        phase,
+        *peak / 1024 / 1024,
+        budget / 1024 / 1024
+    );
+    return false;
+}
+
+void save_stats(const std::string& fileName, util::PhaseStats& stats) {
+    stats.end();
+    if (fileName.empty()) return;
+    if (auto peak = util::getPeakResidentSize()) stats.count("peak_rss_bytes", *peak);
+    stats.print();
+    save_to_json(fileName, stats.toJson());
+}
+
 int main(int argc, char* argv[]) {
 
     init_logger();
 
     // setup I/O file name.
 
-    std::string inputFileName, outputFileBase;
+    ProgramOptions options;
     try {
-        std::tie(inputFileName, outputFileBase) = init_program(argc, argv);
+        options = init_program(argc, argv);
     } catch (const std::runtime_error& e) {
         spdlog::error(e.what());
         return -1;
     }
 
+    if (options.mServe) init_logger(true);
+
+    auto& inputFileName  = options.mInputFile;
+    auto  outputFileBase = options.mOutputFile;
+
+    // e.g. "sample.json.zst" -> "sample" + ".vftable.json" + ".zst"
+    auto compressionSuffix = std::string(output::getCompressionSuffix(output::detectCompression(outputFileBase)));
+    outputFileBase.erase(outputFileBase.size() - compressionSuffix.size());
     if (outputFileBase.ends_with(".json")) {
         outputFileBase.erase(outputFileBase.size() - 5, 5);
     }
 
     spdlog::info("{:<12}{}", "Input file:", inputFileName);
 
-    // judge fileType and processing.
+    // load image and processing.
 
-    MagicHelper magic(inputFileName);
-    if (!magic.isValid()) {
-        spdlog::error("Unable to load input file.");
+    util::PhaseStats stats;
+    // The run goes on without them, PerfCounters tells why.
+    if (options.mPerfCounters) stats.enablePerfCounters();
+    stats.begin("load");
+    std::error_code sizeError;
+    auto            inputSize = std::filesystem::file_size(inputFileName, sizeError);
+    stats.count("bytes", inputSize);
+    // LIEF alone keeps a copy of the whole input.
+    if (options.mMemoryBudget && !sizeError && inputSize > options.mMemoryBudget) {
+        spdlog::error(
+            "{} is {} MiB, over the memory budget of {} MiB.",
+            inputFileName,
+            inputSize / 1024 / 1024,
+            options.mMemoryBudget / 1024 / 1024
+        );
         return -1;
     }
 
-    std::shared_ptr<Executable> image;
-
-    switch (magic.judgeFileType()) {
-    case Magic::ELF:
-        image = std::make_shared<format::ELF>(inputFileName);
-        break;
-    case Magic::MACHO_64:
-        image = std::make_shared<format::MachO>(inputFileName);
-        break;
-    case Magic::PE:
-    case Magic::MACHO_32:
-    case Magic::UNKNOWN:
-    default:
-        spdlog::error("Unsupported file type.");
-        return -1;
+    auto image = metadumper::open(inputFileName, options.mMemoryBudget);
+    if (!image) return -1;
+    auto isWithinBudget = check_memory_budget(options.mMemoryBudget, "loading");
+
+    auto& reader = image->getReader();
+    reader.setLimits(options.mLimits);
+    if (options.mDependencies) {
+        stats.begin("dependencies");
+        if (auto elf = std::dynamic_pointer_cast<format::ELF>(image->getExecutable())) {
+            auto dependencies = std::make_shared<format::DependencyScope>(inputFileName, *elf, *options.mDependencies);
+            reader.setDependencies(std::move(dependencies));
+        } else {
+            spdlog::warn("Dependencies are only resolved for ELF images.");
+        }
     }
 
-    if (!image->isValid()) return -1;
+    if (options.mServe) {
+        try {
+            server::QueryServer server(reader.dumpVFTable(), reader.dumpTypeInfo());
+            if (options.mSocketPath.empty()) server.serveStdio();
+            else if (!server.serveUnixSocket(options.mSocketPath)) return -1;
+        } catch (const std::runtime_error& e) {
+            spdlog::error(e.what());
+            return -1;
+        }
+        return 0;
+    }
 
-    abi::itanium::ItaniumVTableReader reader(image);
+    if (!options.mStorePath.empty()) {
+        try {
+            auto vftable = read_vtable(reader, stats);
+            auto types   = read_typeinfo(reader, stats);
+            stats.begin("store");
+            output::RecordStore store(options.mStorePath);
+            if (!store.ingest(inputFileName, vftable, types)) return -1;
+        } catch (const std::runtime_error& e) {
+            spdlog::error(e.what());
+            return -1;
+        }
+        save_stats(options.mStatsFile, stats);
+        spdlog::info("All works done...");
+        return 0;
+    }
 
     try {
-        auto jsonVftable = read_vtable(reader);
-        auto jsonTypes   = read_typeinfo(reader);
-        save_to_json(outputFileBase + ".vftable.json", jsonVftable);
-        save_to_json(outputFileBase + ".typeinfo.json", jsonTypes);
+        abi::itanium::DumpTypeInfoResult types;
+        abi::itanium::SlotIndex          slots;
+        if (options.mNDJSON) {
+            types = stream_to_ndjson(reader, slots, stats, outputFileBase + ".ndjson" + compressionSuffix);
+        } else if (options.mSQLite) {
+            types = stream_to_sqlite(reader, slots, stats, outputFileBase + ".sqlite");
+        } else if (options.mHeader) {
+            auto fileName = outputFileBase + ".vftable.hpp";
+            types         = stream_to_header(reader, slots, stats, fileName, options.mHeaderNamespace);
+        } else if (options.mMemoryBudget) {
+            types = stream_to_json(reader, slots, stats, outputFileBase, compressionSuffix);
+        } else {
+            auto vftable = read_vtable(reader, stats);
+            types        = read_typeinfo(reader, stats);
+            stats.begin("write");
+            for (auto& table : vftable.mVFTable) slots.add(table);
+            auto jsonVftable = vftable.toJson();
+            auto jsonTypes   = types.toJson();
+            if (options.mShard) {
+                output::ShardWriter shards(outputFileBase, compressionSuffix, *options.mShard);
+                shards.add("vftable", jsonVftable);
+                shards.add("typeinfo", jsonTypes);
+                if (!shards.write()) return -1;
+            } else {
+                save_to_json(outputFileBase + ".vftable.json" + compressionSuffix, jsonVftable);
+                save_to_json(outputFileBase + ".typeinfo.json" + compressionSuffix, jsonTypes);
+            }
+        }
+        stats.begin("slots");
+        slots.build();
+        auto slotsFile = outputFileBase + ".slots.json" + compressionSuffix;
+        if (options.mMemoryBudget) stream_arrays_to_json(slotsFile, slots);
+        else save_to_json(slotsFile, slots.toJson());
+        stats.begin("hierarchy");
+        auto hierarchyFile = outputFileBase + ".hierarchy.json" + compressionSuffix;
+        if (options.mMemoryBudget) stream_arrays_to_json(hierarchyFile, abi::itanium::TypeHierarchy(types));
+        else save_to_json(hierarchyFile, abi::itanium::TypeHierarchy(types).toJson());
     } catch (const std::runtime_error& e) {
         spdlog::error(e.what());
         return -1;
     }
 
+    if (isWithinBudget) check_memory_budget(options.mMemoryBudget, "writing");
+    save_stats(options.mStatsFile, stats);
     spdlog::info("All works done...");
 
     return 0;
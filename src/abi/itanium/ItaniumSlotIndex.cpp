@@ -0,0 +1,110 @@
+#include "ItaniumSlotIndex.h"
+#include "ItaniumVTableReader.h"
+
+#include <algorithm>
+
+using JSON = nlohmann::json;
+
+METADUMPER_ABI_ITANIUM_BEGIN
+
+namespace {
+
+template <typename Key>
+std::span<const SlotIndex::Slot> equal_slots(
+    const std::vector<Key>&             pKeys,
+    const std::vector<uint32_t>&        pOffsets,
+    const std::vector<SlotIndex::Slot>& pSlots,
+    const Key&                          pKey
+) {
+    auto it = std::lower_bound(pKeys.begin(), pKeys.end(), pKey);
+    if (it == pKeys.end() || *it != pKey) return {};
+    auto idx = it - pKeys.begin();
+    return {pSlots.data() + pOffsets[idx], pSlots.data() + pOffsets[idx + 1]};
+}
+
+void visit_slots(
+    const JSONArrayVisitor&             pVisitor,
+    const std::string&                  pKey,
+    const std::vector<SlotIndex::Slot>& pSlots
+) {
+    pVisitor(pKey, pSlots.size(), [&](size_t pIndex) {
+        auto& slot = pSlots[pIndex];
+        return JSON::array({slot.mVTable, slot.mOffset, slot.mSlot});
+    });
+}
+
+} // namespace
+
+SlotIndex::SlotIndex(const DumpVFTableResult& pVFTable) {
+    for (auto& table : pVFTable.mVFTable) add(table);
+    build();
+}
+
+void SlotIndex::add(const VTable& pTable) {
+    auto vtable = (uint32_t)mVTableNames.size();
+    mVTableNames.emplace_back(pTable.mName);
+    for (auto& [offset, columns] : pTable.mSubTables) {
+        for (uint32_t idx = 0; idx < columns.size(); idx++) {
+            auto& column = columns[idx];
+            Slot  slot{vtable, idx, (int64_t)offset};
+            if (column.mRVA && !column.mLibrary) mPendingAddresses.emplace_back(Pending<uintptr_t>{column.mRVA, slot});
+            else if (column.mSymbolName) mPendingSymbols.emplace_back(Pending<std::string>{*column.mSymbolName, slot});
+        }
+    }
+}
+
+void SlotIndex::build() {
+    _buildKeys(mPendingAddresses, mAddresses, mAddressOffsets, mAddressSlots);
+    _buildKeys(mPendingSymbols, mSymbols, mSymbolOffsets, mSymbolSlots);
+}
+
+template <typename Key>
+void SlotIndex::_buildKeys(
+    std::vector<Pending<Key>>& pPending,
+    std::vector<Key>&          pKeys,
+    std::vector<uint32_t>&     pOffsets,
+    std::vector<Slot>&         pSlots
+) {
+    // Stable, so the slots of one key stay in vtable order.
+    std::stable_sort(pPending.begin(), pPending.end(), [](const Pending<Key>& pLhs, const Pending<Key>& pRhs) {
+        return pLhs.mKey < pRhs.mKey;
+    });
+    pKeys.clear();
+    pOffsets.clear();
+    pSlots.clear();
+    pSlots.reserve(pPending.size());
+    for (auto& pending : pPending) {
+        if (pKeys.empty() || pKeys.back() != pending.mKey) {
+            pKeys.emplace_back(std::move(pending.mKey));
+            pOffsets.emplace_back((uint32_t)pSlots.size());
+        }
+        pSlots.emplace_back(pending.mSlot);
+    }
+    pOffsets.emplace_back((uint32_t)pSlots.size());
+    pPending.clear();
+    pPending.shrink_to_fit();
+}
+
+std::span<const SlotIndex::Slot> SlotIndex::lookup(uintptr_t pRVA) const {
+    return equal_slots(mAddresses, mAddressOffsets, mAddressSlots, pRVA);
+}
+
+std::span<const SlotIndex::Slot> SlotIndex::lookup(const std::string& pSymbol) const {
+    return equal_slots(mSymbols, mSymbolOffsets, mSymbolSlots, pSymbol);
+}
+
+JSON SlotIndex::toJson() const { return buildJson(*this); }
+
+void SlotIndex::visitJson(const JSONArrayVisitor& pVisitor) const {
+    if (!size()) return;
+    // Sorted by key, as in a JSON object.
+    visitJsonArray(pVisitor, "address_offsets", mAddressOffsets);
+    visit_slots(pVisitor, "address_slots", mAddressSlots);
+    visitJsonArray(pVisitor, "addresses", mAddresses);
+    visitJsonArray(pVisitor, "symbol_offsets", mSymbolOffsets);
+    visit_slots(pVisitor, "symbol_slots", mSymbolSlots);
+    visitJsonArray(pVisitor, "symbols", mSymbols);
+    visitJsonArray(pVisitor, "vtables", mVTableNames);
+}
+
+METADUMPER_ABI_ITANIUM_END
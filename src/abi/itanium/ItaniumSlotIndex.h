@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ItaniumVTable.h"
+
+#include "base/Base.h"
+
+#include <span>
+
+METADUMPER_ABI_ITANIUM_BEGIN
+
+struct DumpVFTableResult;
+
+// Inverted index of the vtable slots: function address -> every (vtable, sub-table offset, slot index) holding it.
+// Slots of external functions (no address, or one in another library) are keyed by their symbol name instead.
+//
+// Keys are sorted unique arrays, the slots of key i are [offsets[i], offsets[i + 1]) of one flat array, so a
+// lookup is a binary search plus a contiguous range.
+class SlotIndex {
+public:
+    struct Slot {
+        uint32_t mVTable; // see getVTableName().
+        uint32_t mSlot;
+        int64_t  mOffset; // of the sub-table.
+    };
+
+    SlotIndex() = default;
+    explicit SlotIndex(const DumpVFTableResult& pVFTable);
+
+    // Call build() after all vtables are added.
+    void add(const VTable& pTable);
+    void build();
+
+    [[nodiscard]] std::span<const Slot> lookup(uintptr_t pRVA) const;
+    [[nodiscard]] std::span<const Slot> lookup(const std::string& pSymbol) const;
+
+    [[nodiscard]] const std::string& getVTableName(uint32_t pVTable) const { return mVTableNames[pVTable]; }
+    [[nodiscard]] size_t             size() const { return mAddressSlots.size() + mSymbolSlots.size(); }
+
+    [[nodiscard]] nlohmann::json toJson() const;
+    // Same content as toJson(), nothing for an empty index.
+    void visitJson(const JSONArrayVisitor& pVisitor) const;
+
+private:
+    template <typename Key>
+    struct Pending {
+        Key  mKey;
+        Slot mSlot;
+    };
+
+    template <typename Key>
+    static void _buildKeys(
+        std::vector<Pending<Key>>& pPending,
+        std::vector<Key>&          pKeys,
+        std::vector<uint32_t>&     pOffsets,
+        std::vector<Slot>&         pSlots
+    );
+
+    std::vector<std::string> mVTableNames;
+
+    std::vector<Pending<uintptr_t>>   mPendingAddresses;
+    std::vector<Pending<std::string>> mPendingSymbols;
+
+    std::vector<uintptr_t> mAddresses; // sorted, unique
+    std::vector<uint32_t>  mAddressOffsets;
+    std::vector<Slot>      mAddressSlots;
+
+    std::vector<std::string> mSymbols; // sorted, unique
+    std::vector<uint32_t>    mSymbolOffsets;
+    std::vector<Slot>        mSymbolSlots;
+};
+
+METADUMPER_ABI_ITANIUM_END
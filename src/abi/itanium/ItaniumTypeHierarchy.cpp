@@ -0,0 +1,183 @@
+#include "ItaniumTypeHierarchy.h"
+#include "ItaniumVTableReader.h"
+
+using JSON = nlohmann::json;
+
+METADUMPER_ABI_ITANIUM_BEGIN
+
+TypeHierarchy::TypeHierarchy(const DumpTypeInfoResult& pTypeInfo) : TypeHierarchy(pTypeInfo.mTypeInfo) {}
+
+TypeHierarchy::TypeHierarchy(const TypeInfoTable& pTypeInfo) {
+    // Every name of the table is a record or referenced by one.
+    mNames.reserve(pTypeInfo.getNameCount());
+    mIds.reserve(pTypeInfo.getNameCount());
+    for (NodeId node = 0; node < pTypeInfo.getNameCount(); node++) {
+        mIds.try_emplace(mNames.emplace_back(pTypeInfo.getName(node)), node);
+    }
+
+    // (child, parent)
+    std::vector<std::pair<NodeId, NodeId>> edges;
+    for (auto& type : pTypeInfo) {
+        switch (type.mKind) {
+        case TypeInheritKind::None:
+            break;
+        case TypeInheritKind::Single:
+            edges.emplace_back(type.mName, type.mParentType);
+            break;
+        case TypeInheritKind::Multiple:
+            for (auto& base : pTypeInfo.getBases(type)) edges.emplace_back(type.mName, base.mName);
+            break;
+        }
+    }
+    _buildAdjacency(edges);
+    _buildTopologicalOrder();
+    _buildIntervals();
+}
+
+void TypeHierarchy::_buildAdjacency(const std::vector<std::pair<NodeId, NodeId>>& pEdges) {
+    auto count = mNames.size();
+
+    mParentOffsets.assign(count + 1, 0);
+    mChildOffsets.assign(count + 1, 0);
+    for (auto& [child, parent] : pEdges) {
+        mParentOffsets[child + 1]++;
+        mChildOffsets[parent + 1]++;
+    }
+    for (size_t idx = 0; idx < count; idx++) {
+        mParentOffsets[idx + 1] += mParentOffsets[idx];
+        mChildOffsets[idx + 1]  += mChildOffsets[idx];
+    }
+
+    // Edges are in declaration order, so are the filled links.
+    mParents.resize(pEdges.size());
+    mChildren.resize(pEdges.size());
+    std::vector<uint32_t> parentCursor(mParentOffsets.begin(), mParentOffsets.end() - 1);
+    std::vector<uint32_t> childCursor(mChildOffsets.begin(), mChildOffsets.end() - 1);
+    for (auto& [child, parent] : pEdges) {
+        mParents[parentCursor[child]++]  = parent;
+        mChildren[childCursor[parent]++] = child;
+    }
+}
+
+void TypeHierarchy::_buildTopologicalOrder() {
+    // Kahn's algorithm.
+    auto                  count = mNames.size();
+    std::vector<uint32_t> pending(count);
+    for (NodeId node = 0; node < count; node++) {
+        pending[node] = (uint32_t)getParents(node).size();
+        if (!pending[node]) mTopologicalOrder.emplace_back(node);
+    }
+    for (size_t idx = 0; idx < mTopologicalOrder.size(); idx++) {
+        for (auto child : getChildren(mTopologicalOrder[idx])) {
+            if (!--pending[child]) mTopologicalOrder.emplace_back(child);
+        }
+    }
+    if (mTopologicalOrder.size() != count) {
+        // Only possible with broken input, keep the nodes anyway.
+        spdlog::warn("Inheritance cycle detected, {} type(s) are not ordered.", count - mTopologicalOrder.size());
+        for (NodeId node = 0; node < count; node++) {
+            if (pending[node]) mTopologicalOrder.emplace_back(node);
+        }
+    }
+}
+
+void TypeHierarchy::_buildIntervals() {
+    auto count = mNames.size();
+    mPreOrder.assign(count, 0);
+    mPostOrder.assign(count, 0);
+    mTreeExact.assign(count, false);
+
+    // Iterative DFS over the child links, a node reached twice keeps its first (tree) parent.
+    std::vector<bool>                        visited(count);
+    std::vector<std::pair<NodeId, uint32_t>> stack; // (node, next child)
+    uint32_t                                 clock = 0;
+    for (auto root : mTopologicalOrder) {
+        if (visited[root]) continue;
+        visited[root]   = true;
+        mPreOrder[root] = clock++;
+        stack.emplace_back(root, mChildOffsets[root]);
+        while (!stack.empty()) {
+            auto& [node, next] = stack.back();
+            if (next == mChildOffsets[node + 1]) {
+                mPostOrder[node] = clock++;
+                stack.pop_back();
+                continue;
+            }
+            auto child = mChildren[next++];
+            if (visited[child]) continue;
+            visited[child]   = true;
+            mPreOrder[child] = clock++;
+            stack.emplace_back(child, mChildOffsets[child]);
+        }
+    }
+
+    for (auto node : mTopologicalOrder) {
+        auto parents     = getParents(node);
+        mTreeExact[node] = parents.empty() || (parents.size() == 1 && mTreeExact[parents[0]]);
+    }
+}
+
+TypeHierarchy::NodeId TypeHierarchy::find(const std::string& pName) const {
+    auto it = mIds.find(pName);
+    return it != mIds.end() ? it->second : INVALID_NODE;
+}
+
+std::span<const TypeHierarchy::NodeId> TypeHierarchy::getParents(NodeId pNode) const {
+    return {mParents.data() + mParentOffsets[pNode], mParents.data() + mParentOffsets[pNode + 1]};
+}
+
+std::span<const TypeHierarchy::NodeId> TypeHierarchy::getChildren(NodeId pNode) const {
+    return {mChildren.data() + mChildOffsets[pNode], mChildren.data() + mChildOffsets[pNode + 1]};
+}
+
+bool TypeHierarchy::isDerivedFrom(NodeId pDerived, NodeId pBase) const {
+    if (pDerived >= size() || pBase >= size() || pDerived == pBase) return false;
+    // A descendant in the spanning forest is always a real descendant.
+    if (mPreOrder[pBase] < mPreOrder[pDerived] && mPostOrder[pDerived] < mPostOrder[pBase]) return true;
+    if (mTreeExact[pDerived]) return false;
+    auto ancestors = _walk(pDerived, true);
+    return std::find(ancestors.begin(), ancestors.end(), pBase) != ancestors.end();
+}
+
+bool TypeHierarchy::isDerivedFrom(const std::string& pDerived, const std::string& pBase) const {
+    return isDerivedFrom(find(pDerived), find(pBase));
+}
+
+std::vector<TypeHierarchy::NodeId> TypeHierarchy::getAllSubclasses(NodeId pNode) const { return _walk(pNode, false); }
+
+std::vector<TypeHierarchy::NodeId> TypeHierarchy::getAllSuperclasses(NodeId pNode) const { return _walk(pNode, true); }
+
+std::vector<TypeHierarchy::NodeId> TypeHierarchy::_walk(NodeId pNode, bool pUpwards) const {
+    std::vector<NodeId> ret;
+    if (pNode >= size()) return ret;
+    std::vector<bool> visited(size());
+    visited[pNode] = true;
+    ret.emplace_back(pNode);
+    for (size_t idx = 0; idx < ret.size(); idx++) {
+        for (auto next : pUpwards ? getParents(ret[idx]) : getChildren(ret[idx])) {
+            if (visited[next]) continue;
+            visited[next] = true;
+            ret.emplace_back(next);
+        }
+    }
+    ret.erase(ret.begin()); // itself
+    return ret;
+}
+
+JSON TypeHierarchy::toJson() const { return buildJson(*this); }
+
+void TypeHierarchy::visitJson(const JSONArrayVisitor& pVisitor) const {
+    if (mNames.empty()) return;
+    // Sorted by key, as in a JSON object.
+    visitJsonArray(pVisitor, "child_offsets", mChildOffsets);
+    visitJsonArray(pVisitor, "children", mChildren);
+    visitJsonArray(pVisitor, "names", mNames);
+    visitJsonArray(pVisitor, "parent_offsets", mParentOffsets);
+    visitJsonArray(pVisitor, "parents", mParents);
+    visitJsonArray(pVisitor, "post_order", mPostOrder);
+    visitJsonArray(pVisitor, "pre_order", mPreOrder);
+    visitJsonArray(pVisitor, "topological_order", mTopologicalOrder);
+    visitJsonArray(pVisitor, "tree_exact", mTreeExact);
+}
+
+METADUMPER_ABI_ITANIUM_END
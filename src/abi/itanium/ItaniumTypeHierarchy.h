@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ItaniumVTable.h"
+
+#include "base/Base.h"
+
+#include <span>
+
+METADUMPER_ABI_ITANIUM_BEGIN
+
+struct DumpTypeInfoResult;
+
+// Inheritance graph of the decoded typeinfos.
+//
+// Nodes are the name IDs of the typeinfo table, parent and child links are stored as CSR arrays (offsets + flat
+// list). Pre/post-order intervals of a DFS spanning forest answer most ancestor queries in O(1), only nodes that have
+// a multiple inheritance somewhere above them need to fall back to a walk.
+class TypeHierarchy {
+public:
+    using NodeId = uint32_t;
+
+    static constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+    explicit TypeHierarchy(const DumpTypeInfoResult& pTypeInfo);
+    explicit TypeHierarchy(const TypeInfoTable& pTypeInfo);
+
+    [[nodiscard]] NodeId             find(const std::string& pName) const; // _ZTI...
+    [[nodiscard]] const std::string& getName(NodeId pNode) const { return mNames[pNode]; }
+    [[nodiscard]] size_t             size() const { return mNames.size(); }
+
+    [[nodiscard]] std::span<const NodeId> getParents(NodeId pNode) const;
+    [[nodiscard]] std::span<const NodeId> getChildren(NodeId pNode) const;
+
+    // Parents always come before their children.
+    [[nodiscard]] const std::vector<NodeId>& getTopologicalOrder() const { return mTopologicalOrder; }
+
+    // Strict, a type is not derived from itself.
+    [[nodiscard]] bool isDerivedFrom(NodeId pDerived, NodeId pBase) const;
+    [[nodiscard]] bool isDerivedFrom(const std::string& pDerived, const std::string& pBase) const;
+
+    [[nodiscard]] std::vector<NodeId> getAllSubclasses(NodeId pNode) const;
+    [[nodiscard]] std::vector<NodeId> getAllSuperclasses(NodeId pNode) const;
+
+    [[nodiscard]] nlohmann::json toJson() const;
+    // Same content as toJson(), nothing for an empty hierarchy.
+    void visitJson(const JSONArrayVisitor& pVisitor) const;
+
+private:
+    void _buildAdjacency(const std::vector<std::pair<NodeId, NodeId>>& pEdges);
+    void _buildTopologicalOrder();
+    void _buildIntervals();
+
+    std::vector<NodeId> _walk(NodeId pNode, bool pUpwards) const;
+
+    std::vector<std::string>                mNames;
+    std::unordered_map<std::string, NodeId> mIds;
+
+    // CSR, links of node i are [offsets[i], offsets[i + 1]).
+    std::vector<uint32_t> mParentOffsets;
+    std::vector<NodeId>   mParents;
+    std::vector<uint32_t> mChildOffsets;
+    std::vector<NodeId>   mChildren;
+
+    std::vector<NodeId> mTopologicalOrder;
+
+    std::vector<uint32_t> mPreOrder;
+    std::vector<uint32_t> mPostOrder;
+    // All ancestors are reachable through the spanning forest, the intervals are exact.
+    std::vector<bool> mTreeExact;
+};
+
+METADUMPER_ABI_ITANIUM_END
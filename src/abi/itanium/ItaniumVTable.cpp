@@ -23,40 +23,71 @@ JSON VTable::toJson() const {
 }
 
 JSON VTableColumn::toJson() const {
-    return JSON{
+    JSON ret{
         {"symbol", mSymbolName.has_value() ? JSON(*mSymbolName) : JSON{}},
         {"rva",    mRVA                                                 }
     };
+    if (mLibrary) ret["library"] = *mLibrary;
+    return ret;
 }
 
-JSON NoneInheritTypeInfo::toJson() const {
-    return JSON{
-        {"inherit_type", "None"}
-    };
+uint32_t TypeInfoTable::intern(std::string_view pName) {
+    if (auto it = mNameIds.find(pName); it != mNameIds.end()) return it->second;
+    auto  id   = (uint32_t)mNames.size();
+    auto& name = mNames.emplace_back(pName);
+    mNameIds.emplace(name, id);
+    mRecordOfName.emplace_back(INVALID);
+    return id;
 }
 
-JSON SingleInheritTypeInfo::toJson() const {
-    return JSON{
-        {"inherit_type", "Single"   },
-        {"parent_type",  mParentType},
-        {"offset",       mOffset    }
-    };
+uint32_t TypeInfoTable::findName(std::string_view pName) const {
+    auto it = mNameIds.find(pName);
+    return it != mNameIds.end() ? it->second : INVALID;
 }
 
-JSON MultipleInheritTypeInfo::toJson() const {
-    auto baseClasses = JSON::array();
-    for (auto& base : mBaseClasses) {
-        baseClasses.emplace_back(JSON{
-            {"offset", base.mOffset},
-            {"name",   base.mName  },
-            {"mask",   base.mMask  }
-        });
+const TypeInfo& TypeInfoTable::add(TypeInfo pType, std::span<const BaseClassInfo> pBases) {
+    pType.mBaseBegin = (uint32_t)mBases.size();
+    pType.mBaseCount = (uint32_t)pBases.size();
+    mBases.insert(mBases.end(), pBases.begin(), pBases.end());
+    // find() returns the first one of duplicated names.
+    if (mRecordOfName[pType.mName] == INVALID) mRecordOfName[pType.mName] = (uint32_t)mRecords.size();
+    return mRecords.emplace_back(pType);
+}
+
+uint32_t TypeInfoTable::find(std::string_view pName) const {
+    auto name = findName(pName);
+    return name != INVALID ? mRecordOfName[name] : INVALID;
+}
+
+JSON TypeInfoTable::toJson(const TypeInfo& pType) const {
+    switch (pType.mKind) {
+    case TypeInheritKind::Single:
+        return JSON{
+            {"inherit_type", "Single"                  },
+            {"parent_type",  getName(pType.mParentType)},
+            {"offset",       pType.mOffset             }
+        };
+    case TypeInheritKind::Multiple: {
+        auto baseClasses = JSON::array();
+        for (auto& base : getBases(pType)) {
+            baseClasses.emplace_back(JSON{
+                {"offset", base.mOffset       },
+                {"name",   getName(base.mName)},
+                {"mask",   base.mMask         }
+            });
+        }
+        return JSON{
+            {"inherit_type", "Multiple"      },
+            {"attribute",    pType.mAttribute},
+            {"base_classes", baseClasses     }
+        };
+    }
+    case TypeInheritKind::None:
+    default:
+        return JSON{
+            {"inherit_type", "None"}
+        };
     }
-    return JSON{
-        {"inherit_type", "Multiple" },
-        {"attribute",    mAttribute },
-        {"base_classes", baseClasses}
-    };
 }
 
 METADUMPER_ABI_ITANIUM_END
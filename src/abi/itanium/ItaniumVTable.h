@@ -4,50 +4,101 @@
 
 #include <nlohmann/json.hpp>
 
+#include <deque>
+#include <functional>
+#include <span>
+
 METADUMPER_ABI_ITANIUM_BEGIN
 
-enum class TypeInheritKind { None, Single, Multiple };
+// Receives the members of a JSON object of arrays, in key order: the key, the size, and the elements built on demand.
+// Lets the large indexes be written without building their whole document.
+using JSONArrayVisitor =
+    std::function<void(const std::string&, size_t, const std::function<nlohmann::json(size_t)>&)>;
 
-struct TypeInfo {
-    std::string                           mName; // _ZTI...
-    [[nodiscard]] virtual TypeInheritKind kind() const   = 0;
-    [[nodiscard]] virtual nlohmann::json  toJson() const = 0;
-};
+template <typename T>
+void visitJsonArray(const JSONArrayVisitor& pVisitor, const std::string& pKey, const std::vector<T>& pItems) {
+    pVisitor(pKey, pItems.size(), [&](size_t pIndex) { return nlohmann::json(pItems[pIndex]); });
+}
 
-struct NoneInheritTypeInfo : public TypeInfo {
-    using TypeInfo::TypeInfo;
-    [[nodiscard]] TypeInheritKind kind() const override { return TypeInheritKind::None; };
-    [[nodiscard]] nlohmann::json  toJson() const override;
-};
+// The whole document of pSource.visitJson(), null if it visits nothing.
+template <typename Source>
+nlohmann::json buildJson(const Source& pSource) {
+    nlohmann::json ret;
+    pSource.visitJson([&](const std::string& pKey, size_t pSize, const std::function<nlohmann::json(size_t)>& pItem) {
+        auto& array = ret[pKey] = nlohmann::json::array();
+        for (size_t idx = 0; idx < pSize; idx++) array.emplace_back(pItem(idx));
+    });
+    return ret;
+}
 
-struct SingleInheritTypeInfo : public TypeInfo {
-    using TypeInfo::TypeInfo;
-    [[nodiscard]] TypeInheritKind kind() const override { return TypeInheritKind::Single; };
-    [[nodiscard]] nlohmann::json  toJson() const override;
-    std::string                   mParentType; // _ZTI...
-    // bool mIsWeak;
-    ptrdiff_t mOffset;
-};
+enum class TypeInheritKind : uint8_t { None, Single, Multiple };
 
 struct BaseClassInfo {
     enum Mask { Virtual = 0x1, Public = 0x2, Offset = 0x8 };
-    std::string  mName; // _ZTI...
-    ptrdiff_t    mOffset;
-    unsigned int mMask;
+    uint32_t  mName; // name ID, _ZTI...
+    uint32_t  mMask;
+    ptrdiff_t mOffset;
+};
+
+// A plain record, names are IDs of the TypeInfoTable holding it.
+struct TypeInfo {
+    TypeInheritKind mKind;
+    uint32_t        mName;       // _ZTI...
+    uint32_t        mParentType; // Single, _ZTI...
+    uint32_t        mAttribute;  // Multiple
+    uint32_t        mBaseBegin;  // Multiple, [mBaseBegin, mBaseBegin + mBaseCount) of the table's base classes.
+    uint32_t        mBaseCount;
+    ptrdiff_t       mOffset;     // Single
 };
 
-struct MultipleInheritTypeInfo : public TypeInfo {
-    using TypeInfo::TypeInfo;
-    [[nodiscard]] TypeInheritKind kind() const override { return TypeInheritKind::Multiple; };
-    [[nodiscard]] nlohmann::json  toJson() const override;
-    unsigned int                  mAttribute;
-    // bool mIsWeak;
-    std::vector<BaseClassInfo> mBaseClasses;
+// All typeinfos of an image in a few flat arrays: the records, the base classes of every record back to back, and
+// each distinct name once.
+class TypeInfoTable {
+public:
+    static constexpr uint32_t INVALID = UINT32_MAX;
+
+    TypeInfoTable() = default;
+    // Moves keep the names in place, copies would not.
+    TypeInfoTable(TypeInfoTable&&)            = default;
+    TypeInfoTable& operator=(TypeInfoTable&&) = default;
+    TypeInfoTable(const TypeInfoTable&)       = delete;
+
+    uint32_t                         intern(std::string_view pName);
+    [[nodiscard]] uint32_t           findName(std::string_view pName) const;
+    [[nodiscard]] const std::string& getName(uint32_t pName) const { return mNames[pName]; }
+    [[nodiscard]] size_t             getNameCount() const { return mNames.size(); }
+
+    // Names of pType and pBases must be interned already, pType.mBaseBegin/mBaseCount are filled in.
+    const TypeInfo& add(TypeInfo pType, std::span<const BaseClassInfo> pBases = {});
+
+    // Record index of the typeinfo named pName, or INVALID.
+    [[nodiscard]] uint32_t find(std::string_view pName) const;
+
+    [[nodiscard]] std::span<const BaseClassInfo> getBases(const TypeInfo& pType) const {
+        return {mBases.data() + pType.mBaseBegin, pType.mBaseCount};
+    }
+
+    [[nodiscard]] const TypeInfo& operator[](size_t pIndex) const { return mRecords[pIndex]; }
+    [[nodiscard]] size_t          size() const { return mRecords.size(); }
+    [[nodiscard]] bool            empty() const { return mRecords.empty(); }
+    [[nodiscard]] auto            begin() const { return mRecords.begin(); }
+    [[nodiscard]] auto            end() const { return mRecords.end(); }
+
+    [[nodiscard]] nlohmann::json toJson(const TypeInfo& pType) const;
+
+private:
+    std::deque<std::string>                        mNames; // stable, mNameIds refers to them.
+    std::unordered_map<std::string_view, uint32_t> mNameIds;
+    std::vector<uint32_t>                          mRecordOfName; // name ID -> record index, or INVALID.
+
+    std::vector<TypeInfo>      mRecords;
+    std::vector<BaseClassInfo> mBases;
 };
 
 struct VTableColumn {
     std::optional<std::string> mSymbolName;
     uintptr_t                  mRVA{};
+    std::optional<std::string> mLibrary; // Defining library of an external slot, mRVA is then relative to it.
     nlohmann::json             toJson() const;
 };
 
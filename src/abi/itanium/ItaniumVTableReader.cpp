@@ -3,17 +3,368 @@
 #include "format/ELF.h"
 #include "format/MachO.h"
 
+#include "util/Parallel.h"
 #include "util/String.h"
 
+#include <limits>
+
 using JSON = nlohmann::json;
 
 METADUMPER_ABI_ITANIUM_BEGIN
 
+class ItaniumVTableReader::Decoder {
+public:
+    virtual ~Decoder() = default;
+
+    virtual void                  scanVTables(const std::function<void(uintptr_t, VTable&&)>& pCallback) = 0;
+    virtual std::optional<VTable> readVTable()                                                           = 0;
+    virtual const TypeInfo*       readTypeInfo(TypeInfoTable& pTable)                                    = 0;
+};
+
+template <typename Traits>
+class ItaniumVTableReader::DecoderImpl final : public Decoder {
+public:
+    explicit DecoderImpl(ItaniumVTableReader& pReader)
+    : mReader(pReader),
+      mImage(pReader.mImage),
+      _constant(pReader._constant),
+      mPrepared(pReader.mPrepared),
+      mLimits(pReader.mLimits) {
+        for (auto& section : mImage->getImage()->sections()) {
+            if (!section.virtual_address() || !section.size()) continue;
+            mSections.emplace_back(section.virtual_address(), section.virtual_address() + section.size());
+        }
+        std::sort(mSections.begin(), mSections.end());
+    }
+
+    void scanVTables(const std::function<void(uintptr_t, VTable&&)>& pCallback) override {
+        if (mPrepared.mTypeInfoBegins.empty()) {
+            _probeVTables(pCallback);
+            return;
+        }
+
+        // A primary vtable stores its typeinfo right after the offset to top, so every word referencing a known
+        // typeinfo, minus one word, is a candidate. Secondary sub-tables reference it too, they are skipped as
+        // part of the primary one. Vtables of classes built without RTTI (-fno-rtti) store 0 instead, their
+        // candidates are the "0, 0, function" triples found by the same pass, as the full probe would.
+        if (!mPrepared.mTypeInfoReferences) _buildTypeInfoReferences();
+        auto candidates = mPrepared.mUntypedVTableCandidates;
+        for (auto& [type, locations] : *mPrepared.mTypeInfoReferences) {
+            for (auto location : locations) candidates.emplace_back(location - POINTER_SIZE);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        uintptr_t end{};
+        for (auto begin : candidates) {
+            if (begin < end || !mImage->isInSection(begin, _constant.SEGMENT_DATA) || !_isVTableBegin(begin)) continue;
+            mImage->move(begin, Begin);
+            auto vt = readVTable();
+            end     = mImage->cur();
+            if (vt) pCallback(begin, std::move(*vt));
+        }
+    }
+
+    std::optional<VTable> readVTable() override {
+        VTable                     result;
+        std::optional<std::string> symbol;
+        ptrdiff_t                  offset{};
+        std::string                type;
+        unsigned int               slots{};
+        bool                       isSectionEnd{};
+
+        auto end  = _getSectionEnd(mImage->cur());
+        auto fail = [&](std::string_view pReason) -> std::optional<VTable> {
+            spdlog::warn(
+                "Failed to reading vtable at {:#x} in {}. [{}]",
+                mImage->last(),
+                symbol.has_value() ? *symbol : "<unknown>",
+                pReason
+            );
+            return std::nullopt;
+        };
+        if (auto symbol_ = mImage->lookupSymbol(mImage->cur())) {
+            symbol = symbol_->name();
+            if (!symbol->starts_with(_constant.PREFIX_VTABLE)) {
+                spdlog::warn("Failed to reading vtable at {:#x}. [CURRENT_IS_NOT_VTABLE]", mImage->cur());
+                mImage->move(POINTER_SIZE);
+                return std::nullopt;
+            }
+        }
+        while (true) {
+            auto ptr = mImage->cur();
+            if (ptr + POINTER_SIZE > end) { // stopped, the last table of the section.
+                if (result.mSubTables.empty()) return fail("SECTION_END");
+                isSectionEnd = true;
+                break;
+            }
+            auto value   = _readOffset();
+            auto address = (uintptr_t)(typename Traits::Pointer)value;
+            // pre-check
+            auto external = mPrepared.mExternalSymbolPosition.find(ptr);
+            if (!mImage->isInSection(address, _constant.SEGMENT_TEXT)
+                && external == mPrepared.mExternalSymbolPosition.end()) {
+                // read: Header
+                if (value > 0) break; // stopped.
+                // no room left for the typeinfo.
+                if (mImage->cur() + POINTER_SIZE > end) return fail("SECTION_END");
+                if (result.mSubTables.empty()) { // value == 0, is main table.
+                    if (value != 0) return fail("ABNORMAL_THIS_OFFSET");
+                    // read: TypeInfo
+                    type = _readZTI();
+                    if (!type.empty()) {
+                        if (!type.starts_with(_constant.PREFIX_TYPEINFO)) return fail("INVALID_TYPEINFO");
+                        if (!symbol) {
+                            auto name = util::string::remove_prefix(type, _constant.PREFIX_TYPEINFO);
+                            symbol    = _constant.PREFIX_VTABLE + name;
+                        }
+                        result.mTypeName = type;
+                    }
+                } else {                   // value < 0, multi-inherited, is sub table,
+                    if (value == 0) break; // stopped, another vtable.
+                    if (result.mSubTables.size() >= mLimits.mMaxSubTables) return fail("SUB_TABLE_LIMIT");
+                    offset = value;
+                    // check is same typeInfo:
+                    if (_readZTI() != type) return fail("TYPEINFO_MISMATCH");
+                }
+                continue;
+            }
+            // read: Entities
+            if (_isTableBegin(ptr)) break; // stopped, e.g. the imported type_info vptr of a typeinfo right after.
+            if (++slots > mLimits.mMaxSlots) return fail("SLOT_LIMIT");
+            if (external != mPrepared.mExternalSymbolPosition.end()) {
+                result.mSubTables[offset].emplace_back(mReader._resolveExternal(external->second));
+            } else if (mPrepared.mPureVirtual && address == mPrepared.mPureVirtual->mRVA) {
+                result.mSubTables[offset].emplace_back(*mPrepared.mPureVirtual);
+            } else {
+                result.mSubTables[offset].emplace_back(VTableColumn{_lookupSymbolName(address), address});
+            }
+        }
+        if (!symbol) {
+            spdlog::warn("Failed to reading vtable at {:#x} in <unknown>. [NAME_NOT_FOUND]", mImage->last());
+            return std::nullopt;
+        }
+        if (!isSectionEnd) mImage->move(-POINTER_SIZE); // go back.
+        result.mName = *symbol;
+        return result;
+    }
+
+    const TypeInfo* readTypeInfo(TypeInfoTable& pTable) override {
+        // Reference:
+        // https://itanium-cxx-abi.github.io/cxx-abi/abi.html#rtti-layout
+
+        auto beginAddr = mImage->cur();
+
+        auto inheritIndicatorValue = _readPointer() - Traits::TYPE_INFO_SIZE;
+
+        auto kind = _getTypeInfoKind(beginAddr, inheritIndicatorValue);
+        if (!kind) return nullptr;
+        // Names are only interned once the whole record is read.
+        TypeInfo result{};
+        // spdlog::debug("Processing: {:#x}", beginAddr);
+        if (*kind == TypeInfoKind::Class) {
+            auto name = _readZTS();
+            if (name.empty()) {
+                spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
+                return nullptr;
+            }
+            result.mKind = TypeInheritKind::None;
+            result.mName = pTable.intern(name);
+            return &pTable.add(result);
+        }
+        if (*kind == TypeInfoKind::SingleInheritance) {
+            auto name       = _readZTS();
+            auto parentType = _readZTI();
+            if (name.empty() || parentType.empty()) {
+                spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
+                return nullptr;
+            }
+            result.mKind       = TypeInheritKind::Single;
+            result.mName       = pTable.intern(name);
+            result.mParentType = pTable.intern(parentType);
+            result.mOffset     = 0x0;
+            return &pTable.add(result);
+        }
+        if (*kind == TypeInfoKind::VirtualMultipleInheritance) {
+            auto name = _readZTS();
+            if (name.empty()) {
+                spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
+                return nullptr;
+            }
+            result.mAttribute = mImage->readAs<Traits, uint32_t>();
+            auto baseCount    = mImage->readAs<Traits, uint32_t>();
+            mBaseNames.clear();
+            mBases.clear();
+            for (unsigned int idx = 0; idx < baseCount; idx++) {
+                auto& baseName = mBaseNames.emplace_back(_readZTI());
+                if (baseName.empty()) {
+                    spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
+                    return nullptr;
+                }
+                auto flag = _readOffset();
+                mBases.emplace_back(BaseClassInfo{0, (uint32_t)(flag & 0xFF), (flag >> 8) & 0xFF});
+            }
+            result.mKind = TypeInheritKind::Multiple;
+            result.mName = pTable.intern(name);
+            for (size_t idx = 0; idx < mBases.size(); idx++) mBases[idx].mName = pTable.intern(mBaseNames[idx]);
+            return &pTable.add(result, mBases);
+        }
+        // TypeInfoKind::Other, not a class.
+        return nullptr;
+    }
+
+private:
+    // By address first, resolved once by the reader. Names are only looked up if that fails, which is rare.
+    std::optional<TypeInfoKind> _getTypeInfoKind(uintptr_t pTypeInfo, uintptr_t pVTable) {
+        if (auto it = mPrepared.mTypeInfoKindOfImport.find(pTypeInfo); it != mPrepared.mTypeInfoKindOfImport.end()) {
+            return it->second;
+        }
+        for (auto& [address, kind] : mPrepared.mTypeInfoKindOfVTable) {
+            if (address == pVTable) return kind;
+        }
+        std::string_view name;
+        if (auto external = mPrepared.mExternalSymbolPosition.find(pTypeInfo);
+            external != mPrepared.mExternalSymbolPosition.end()) {
+            name = external->second;
+        } else if (auto symbol = mImage->lookupSymbol(pVTable)) {
+            name = symbol->name();
+        } else {
+            spdlog::warn("Failed to reading type info at {:#x}. [CURRENT_IS_NOT_TYPEINFO]", pTypeInfo);
+            return std::nullopt;
+        }
+        auto kind = _constant.TYPE_INFO_VTABLES.find(std::string(name));
+        if (kind == _constant.TYPE_INFO_VTABLES.end()) return std::nullopt;
+        return kind->second;
+    }
+
+    static constexpr intptr_t POINTER_SIZE = Traits::POINTER_SIZE;
+
+    // Signed, e.g. offset to top.
+    intptr_t _readOffset() { return mImage->readAs<Traits, typename Traits::Offset>(); }
+
+    uintptr_t _readPointer() { return mImage->readAs<Traits>(); }
+
+    // Without RTTI, every word of the data section is probed.
+    void _probeVTables(const std::function<void(uintptr_t, VTable&&)>& pCallback) {
+        for (auto& section : mImage->getImage()->sections()) {
+            if (section.name() != _constant.SEGMENT_DATA) continue;
+            mImage->move(section.virtual_address(), Begin);
+            while (mImage->isInSection(mImage->cur(), _constant.SEGMENT_DATA)) {
+                auto backAddr = mImage->cur();
+                if (_isVTableBegin(backAddr)) {
+                    mImage->move(backAddr, Begin);
+                    auto vt = readVTable();
+                    if (vt) pCallback(backAddr, std::move(*vt));
+                } else {
+                    mImage->move(backAddr + POINTER_SIZE, Begin);
+                }
+            }
+        }
+    }
+
+    bool _isVTableBegin(uintptr_t pVAddr) {
+        mImage->move(pVAddr, Begin);
+        auto expect1 = _readOffset();  // offset to this
+        auto expect2 = _readPointer(); // type info
+        auto expect3 = mImage->cur();
+        auto expect4 = _readPointer(); // first function
+        return expect1 == 0 && (expect2 == 0 || mPrepared.mTypeInfoBegins.contains(expect2))
+            && (mImage->isInSection(expect4, _constant.SEGMENT_TEXT)
+                || mPrepared.mExternalSymbolPosition.contains(expect3))
+            && !_isTableBegin(expect3);
+    }
+
+    // Starts a typeinfo or a vtable, so it can't be a slot: the first word of a typeinfo is an imported __cxxabiv1
+    // vptr, which would otherwise pass for an external slot of the vtable right before.
+    bool _isTableBegin(uintptr_t pVAddr) const {
+        return mPrepared.mTypeInfoBegins.contains(pVAddr) || mPrepared.mVTableBegins.contains(pVAddr)
+            || mPrepared.mTypeInfoKindOfImport.contains(pVAddr);
+    }
+
+    // One linear pass over the data sections.
+    void _buildTypeInfoReferences() {
+        auto& references = mPrepared.mTypeInfoReferences.emplace();
+        auto& untyped    = mPrepared.mUntypedVTableCandidates;
+        for (auto& section : mImage->getImage()->sections()) {
+            if (section.name() != _constant.SEGMENT_DATA) continue;
+            mImage->move(section.virtual_address(), Begin);
+            // The two words before, non-zero at the beginning of the section.
+            uintptr_t offsetToTop = 1, typeInfo = 1;
+            for (size_t idx = 0; idx + POINTER_SIZE <= section.size(); idx += POINTER_SIZE) {
+                auto location = mImage->cur();
+                auto value    = _readPointer();
+                if (mPrepared.mTypeInfoBegins.contains(value)) references[value].emplace_back(location);
+                // Same first slot as _isVTableBegin() accepts.
+                if (!offsetToTop && !typeInfo
+                    && (mImage->isInSection(value, _constant.SEGMENT_TEXT)
+                        || mPrepared.mExternalSymbolPosition.contains(location))
+                    && !_isTableBegin(location)) {
+                    untyped.emplace_back(location - 2 * POINTER_SIZE);
+                }
+                offsetToTop = typeInfo;
+                typeInfo    = value;
+            }
+        }
+    }
+
+    std::string _readZTS() {
+        auto value = _readPointer();
+        // spdlog::debug("\tReading ZTS at {:#x}", value);
+        if (!mImage->isInSection(value, _constant.SEGMENT_READONLY_DATA)) return {};
+        auto str = mImage->readCString(value, 2048);
+        return str.empty() ? str : _constant.PREFIX_TYPEINFO + str;
+    }
+
+    std::string _readZTI() {
+        auto backAddr = mImage->cur() + POINTER_SIZE;
+        auto value    = _readPointer();
+        if (!mImage->isInSection(value, _constant.SEGMENT_DATA)) { // external
+            if (auto sym = mImage->lookupSymbol(value)) return sym->name();
+            else return {};
+        }
+        mImage->move(value, Begin);
+        mImage->move(POINTER_SIZE); // ignore ZTI
+        auto str = _readZTS();
+        mImage->move(backAddr, Begin);
+        return str;
+    }
+
+    std::optional<std::string> _lookupSymbolName(uintptr_t pVAddr) { return mReader._lookupSymbolName(pVAddr); }
+
+    // End of the section containing pVAddr, a table never crosses it.
+    uintptr_t _getSectionEnd(uintptr_t pVAddr) const {
+        auto it = std::upper_bound(
+            mSections.begin(),
+            mSections.end(),
+            std::make_pair(pVAddr, std::numeric_limits<uintptr_t>::max())
+        );
+        if (it == mSections.begin() || pVAddr >= std::prev(it)->second) return std::numeric_limits<uintptr_t>::max();
+        return std::prev(it)->second;
+    }
+
+    ItaniumVTableReader&        mReader;
+    std::shared_ptr<Executable> mImage;
+    const FormatConstants&      _constant;
+    PreparedData&               mPrepared;
+    const VTableLimits&         mLimits;
+
+    // Of the typeinfo being read.
+    std::vector<std::string>   mBaseNames;
+    std::vector<BaseClassInfo> mBases;
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> mSections; // [begin, end), sorted.
+};
+
 ItaniumVTableReader::ItaniumVTableReader(const std::shared_ptr<Executable>& image) : mImage(image) {
     _initFormatConstants();
     _prepareData();
+    _resolveRuntimeSymbols();
+    mDecoder = dispatchTarget(mImage->getPointerSize(), mImage->getEndianness(), [&](auto pTraits) {
+        return std::unique_ptr<Decoder>(std::make_unique<DecoderImpl<decltype(pTraits)>>(*this));
+    });
 }
 
+ItaniumVTableReader::~ItaniumVTableReader() = default;
+
 void ItaniumVTableReader::_initFormatConstants() {
     if (dynamic_cast<format::ELF*>(mImage.get())) {
         _constant.SEGMENT_DATA          = ".data.rel.ro";
@@ -21,37 +372,80 @@ void ItaniumVTableReader::_initFormatConstants() {
         _constant.SEGMENT_TEXT          = ".text";
         _constant.PREFIX_VTABLE         = "_ZTV";
         _constant.PREFIX_TYPEINFO       = "_ZTI";
-        _constant.SYM_CLASS_INFO        = "_ZTVN10__cxxabiv117__class_type_infoE";
-        _constant.SYM_SI_CLASS_INFO     = "_ZTVN10__cxxabiv120__si_class_type_infoE";
-        _constant.SYM_VMI_CLASS_INFO    = "_ZTVN10__cxxabiv121__vmi_class_type_infoE";
+        _constant.PREFIX_CXXABI_VTABLE  = "_ZTVN10__cxxabiv1";
         _constant.SYM_PURE_VFN          = "__cxa_pure_virtual";
-        return;
-    }
-    if (dynamic_cast<format::MachO*>(mImage.get())) {
+    } else if (dynamic_cast<format::MachO*>(mImage.get())) {
         _constant.SEGMENT_DATA          = "__const";
         _constant.SEGMENT_READONLY_DATA = "__const";
         _constant.SEGMENT_TEXT          = "__text";
         _constant.PREFIX_VTABLE         = "_ZTV"; // internal
         _constant.PREFIX_TYPEINFO       = "_ZTI";
-        _constant.SYM_CLASS_INFO        = "__ZTVN10__cxxabiv117__class_type_infoE";
-        _constant.SYM_SI_CLASS_INFO     = "__ZTVN10__cxxabiv120__si_class_type_infoE";
-        _constant.SYM_VMI_CLASS_INFO    = "__ZTVN10__cxxabiv121__vmi_class_type_infoE";
+        _constant.PREFIX_CXXABI_VTABLE  = "__ZTVN10__cxxabiv1";
         _constant.SYM_PURE_VFN          = "___cxa_pure_virtual";
+    } else {
         return;
     }
+    // Reference:
+    // https://itanium-cxx-abi.github.io/cxx-abi/abi.html#rtti-layout
+    constexpr std::pair<std::string_view, TypeInfoKind> TYPE_INFO_CLASSES[] = {
+        {"17__class_type_infoE",             TypeInfoKind::Class                     },
+        {"20__si_class_type_infoE",          TypeInfoKind::SingleInheritance         },
+        {"21__vmi_class_type_infoE",         TypeInfoKind::VirtualMultipleInheritance},
+        {"23__fundamental_type_infoE",       TypeInfoKind::Other                     },
+        {"17__array_type_infoE",             TypeInfoKind::Other                     },
+        {"20__function_type_infoE",          TypeInfoKind::Other                     },
+        {"16__enum_type_infoE",              TypeInfoKind::Other                     },
+        {"19__pointer_type_infoE",           TypeInfoKind::Other                     },
+        {"29__pointer_to_member_type_infoE", TypeInfoKind::Other                     },
+    };
+    for (auto& [name, kind] : TYPE_INFO_CLASSES) {
+        _constant.TYPE_INFO_VTABLES.emplace(_constant.PREFIX_CXXABI_VTABLE + std::string(name), kind);
+    }
+}
+
+void ItaniumVTableReader::_classifyImport(uintptr_t pAddress, const std::string& pName) {
+    if (!pName.starts_with(_constant.PREFIX_CXXABI_VTABLE)) return;
+    auto kind = _constant.TYPE_INFO_VTABLES.find(pName);
+    if (kind == _constant.TYPE_INFO_VTABLES.end()) return;
+    mPrepared.mTypeInfoKindOfImport.try_emplace(pAddress, kind->second);
+    // Only classes have vtables.
+    if (kind->second != TypeInfoKind::Other) mPrepared.mTypeInfoBegins.emplace(pAddress);
+}
+
+void ItaniumVTableReader::_resolveRuntimeSymbols() {
+    if (!mImage->isValid()) return;
+    for (auto& [name, kind] : _constant.TYPE_INFO_VTABLES) {
+        auto symbol = mImage->lookupSymbol(name);
+        // 0 for undefined ones, their typeinfos are classified by _classifyImport().
+        if (symbol && symbol->value()) mPrepared.mTypeInfoKindOfVTable.emplace_back(symbol->value(), kind);
+    }
+    if (auto symbol = mImage->lookupSymbol(_constant.SYM_PURE_VFN); symbol && symbol->value()) {
+        mPrepared.mPureVirtual = VTableColumn{_lookupSymbolName(symbol->value()), symbol->value()};
+    }
 }
 
 DumpVFTableResult ItaniumVTableReader::dumpVFTable() {
+    std::vector<VTable> tables;
+    auto result     = dumpVFTable([&](VTable&& pTable) { tables.emplace_back(std::move(pTable)); });
+    result.mVFTable = std::move(tables);
+    return result;
+}
+
+DumpVFTableResult ItaniumVTableReader::dumpVFTable(const std::function<void(VTable&&)>& pCallback) {
+    return dumpVFTableBegins([&](uintptr_t, VTable&& pTable) { pCallback(std::move(pTable)); });
+}
+
+DumpVFTableResult ItaniumVTableReader::dumpVFTableBegins(const std::function<void(uintptr_t, VTable&&)>& pCallback) {
     DumpVFTableResult result;
 
     // Dump with symbol table:
     if (!mPrepared.mVTableBegins.empty()) {
         for (auto& addr : mPrepared.mVTableBegins) {
             mImage->move(addr, Begin);
-            auto vt = readVTable();
+            auto vt = mDecoder->readVTable();
             result.mTotal++;
             if (vt) {
-                result.mVFTable.emplace_back(*vt);
+                pCallback(addr, std::move(*vt));
                 result.mParsed++;
             }
         }
@@ -60,225 +454,87 @@ DumpVFTableResult ItaniumVTableReader::dumpVFTable() {
 
     // Dump without symbol table:
 
-    for (auto& section : mImage->getImage()->sections()) {
-        if (section.name() != _constant.SEGMENT_DATA) continue;
-        mImage->move(section.virtual_address(), Begin);
-        while (mImage->isInSection(mImage->cur(), _constant.SEGMENT_DATA)) {
-            auto backAddr = mImage->cur();
-            auto expect1  = mImage->read<intptr_t>(); // offset to this
-            auto expect2  = mImage->read<intptr_t>(); // type info
-            auto expect3  = mImage->cur();
-            auto expect4  = mImage->read<intptr_t>(); // first function
-            mImage->move(backAddr, Begin);
-            if (expect1 == 0 && (expect2 == 0 || mPrepared.mTypeInfoBegins.contains(expect2))
-                && (mImage->isInSection(expect4, _constant.SEGMENT_TEXT)
-                    || (mPrepared.mExternalSymbolPosition.contains(expect3)
-                        && mPrepared.mExternalSymbolPosition.at(expect3) == _constant.SYM_PURE_VFN))) {
-                auto vt = readVTable();
-                if (vt) {
-                    result.mVFTable.emplace_back(*vt);
-                    result.mParsed++;
-                }
-            } else {
-                mImage->move(sizeof(intptr_t));
-            }
-        }
-    }
+    mDecoder->scanVTables([&](uintptr_t pVAddr, VTable&& pTable) {
+        pCallback(pVAddr, std::move(pTable));
+        result.mParsed++;
+    });
 
     return result;
 }
 
-std::string ItaniumVTableReader::_readZTS() {
-    auto value = mImage->read<intptr_t>();
-    // spdlog::debug("\tReading ZTS at {:#x}", value);
-    if (!mImage->isInSection(value, _constant.SEGMENT_READONLY_DATA)) return {};
-    auto str = mImage->readCString(value, 2048);
-    return str.empty() ? str : _constant.PREFIX_TYPEINFO + str;
+std::optional<VTable> ItaniumVTableReader::readVTableAt(uintptr_t pVAddr) {
+    mImage->move(pVAddr, Begin);
+    return mDecoder->readVTable();
 }
 
-std::string ItaniumVTableReader::_readZTI() {
-    auto backAddr = mImage->cur() + sizeof(intptr_t);
-    auto value    = mImage->read<intptr_t>();
-    if (!mImage->isInSection(value, _constant.SEGMENT_DATA)) { // external
-        if (auto sym = mImage->lookupSymbol(value)) return sym->name();
-        else return {};
-    }
-    mImage->move(value, Begin);
-    mImage->move(sizeof(intptr_t)); // ignore ZTI
-    auto str = _readZTS();
-    mImage->move(backAddr, Begin);
-    return str;
+const TypeInfo* ItaniumVTableReader::readTypeInfoAt(uintptr_t pVAddr, TypeInfoTable& pTable) {
+    mImage->move(pVAddr, Begin);
+    return mDecoder->readTypeInfo(pTable);
 }
 
-std::optional<VTable> ItaniumVTableReader::readVTable() {
-    VTable                     result;
-    std::optional<std::string> symbol;
-    ptrdiff_t                  offset{};
-    std::string                type;
-    if (auto symbol_ = mImage->lookupSymbol(mImage->cur())) {
-        symbol = symbol_->name();
-        if (!symbol->starts_with(_constant.PREFIX_VTABLE)) {
-            spdlog::warn("Failed to reading vtable at {:#x}. [CURRENT_IS_NOT_VTABLE]", mImage->cur());
-            mImage->move(sizeof(intptr_t));
-            return std::nullopt;
-        }
+std::vector<uintptr_t> ItaniumVTableReader::getVTableBegins() {
+    if (!mPrepared.mVTableBegins.empty()) {
+        std::vector<uintptr_t> ret(mPrepared.mVTableBegins.begin(), mPrepared.mVTableBegins.end());
+        std::sort(ret.begin(), ret.end());
+        return ret;
     }
-    while (true) {
-        auto ptr   = mImage->cur();
-        auto value = mImage->read<intptr_t>();
-        // pre-check
-        if (!mImage->isInSection(value, _constant.SEGMENT_TEXT)
-            && !(
-                mPrepared.mExternalSymbolPosition.contains(ptr)
-                && mPrepared.mExternalSymbolPosition.at(ptr) == _constant.SYM_PURE_VFN
-            )) {
-            // read: Header
-            if (value > 0) break;            // stopped.
-            if (result.mSubTables.empty()) { // value == 0, is main table.
-                if (value != 0) {
-                    spdlog::warn(
-                        "Failed to reading vtable at {:#x} in {}. [ABNORMAL_THIS_OFFSET]",
-                        mImage->last(),
-                        symbol.has_value() ? *symbol : "<unknown>"
-                    );
-                    return std::nullopt;
-                }
-                // read: TypeInfo
-                type = _readZTI();
-                if (!type.empty()) {
-                    if (!type.starts_with(_constant.PREFIX_TYPEINFO)) {
-                        spdlog::warn(
-                            "Failed to reading vtable at {:#x} in {}. [INVALID_TYPEINFO]",
-                            mImage->last(),
-                            symbol.has_value() ? *symbol : "<unknown>"
-                        );
-                        return std::nullopt;
-                    }
-                    if (!symbol)
-                        symbol = _constant.PREFIX_VTABLE + util::string::remove_prefix(type, _constant.PREFIX_TYPEINFO);
-                    result.mTypeName = type;
-                }
-            } else {                   // value < 0, multi-inherited, is sub table,
-                if (value == 0) break; // stopped, another vtable.
-                offset = value;
-                // check is same typeInfo:
-                if (_readZTI() != type) {
-                    spdlog::warn(
-                        "Failed to reading vtable at {:#x} in {}. [TYPEINFO_MISMATCH]",
-                        mImage->last(),
-                        symbol.has_value() ? *symbol : "<unknown>"
-                    );
-                    return std::nullopt;
-                }
-            }
-            continue;
-        }
-        // read: Entities
-        if (mPrepared.mExternalSymbolPosition.contains(ptr)) {
-            result.mSubTables[offset].emplace_back(
-                VTableColumn{std::make_optional(mPrepared.mExternalSymbolPosition.at(ptr)), 0x0}
-            );
-        } else {
-            auto curSym = mImage->lookupSymbol(value);
-            result.mSubTables[offset].emplace_back(
-                VTableColumn{curSym ? std::make_optional(curSym->name()) : std::nullopt, (uintptr_t)value}
-            );
-        }
+    if (!mPrepared.mScannedVTableBegins) {
+        std::vector<uintptr_t> ret;
+        mDecoder->scanVTables([&](uintptr_t pVAddr, VTable&&) { ret.emplace_back(pVAddr); });
+        mPrepared.mScannedVTableBegins = std::move(ret);
     }
-    if (!symbol) {
-        spdlog::warn("Failed to reading vtable at {:#x} in <unknown>. [NAME_NOT_FOUND]", mImage->last());
-        return std::nullopt;
+    return *mPrepared.mScannedVTableBegins;
+}
+
+std::vector<uintptr_t> ItaniumVTableReader::getTypeInfoBegins() const {
+    std::vector<uintptr_t> ret(mPrepared.mTypeInfoBegins.begin(), mPrepared.mTypeInfoBegins.end());
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+VTableColumn ItaniumVTableReader::_resolveExternal(std::string_view pSymbol) const {
+    if (mDependencies) {
+        if (auto definition = mDependencies->find(pSymbol)) {
+            return VTableColumn{std::string(pSymbol), definition->mRVA, definition->mLibrary};
+        }
     }
-    mImage->move(-sizeof(intptr_t)); // go back.
-    result.mName = *symbol;
-    return result;
+    return VTableColumn{std::string(pSymbol), 0x0};
+}
+
+std::optional<std::string> ItaniumVTableReader::_lookupSymbolName(uintptr_t pVAddr) {
+    if (auto symbol = mImage->lookupSymbol(pVAddr)) return symbol->name();
+    // e.g. thunks, or functions with only a local or partial symbol.
+    size_t offset{};
+    if (auto symbol = mImage->lookupContainingSymbol(pVAddr, offset); symbol && !symbol->name().empty())
+        return fmt::format("{}+{:#x}", symbol->name(), offset);
+    return std::nullopt;
 }
 
 DumpTypeInfoResult ItaniumVTableReader::dumpTypeInfo() {
+    return dumpTypeInfo([](const TypeInfoTable&, const TypeInfo&) {});
+}
+
+DumpTypeInfoResult
+ItaniumVTableReader::dumpTypeInfo(const std::function<void(const TypeInfoTable&, const TypeInfo&)>& pCallback) {
     DumpTypeInfoResult result;
     result.mTotal = mPrepared.mTypeInfoBegins.size();
     for (auto& addr : mPrepared.mTypeInfoBegins) {
         mImage->move(addr, Begin);
-        std::unique_ptr<TypeInfo> type;
+        const TypeInfo* type{};
         try {
-            type = readTypeInfo();
+            type = mDecoder->readTypeInfo(result.mTypeInfo);
         } catch (const std::runtime_error& e) {
             spdlog::error(e.what());
             break;
         }
         if (type) {
-            result.mTypeInfo.emplace_back(std::move(type));
+            pCallback(result.mTypeInfo, *type);
             result.mParsed++;
         }
     }
     return result;
 }
 
-std::unique_ptr<TypeInfo> ItaniumVTableReader::readTypeInfo() {
-    // Reference:
-    // https://itanium-cxx-abi.github.io/cxx-abi/abi.html#rtti-layout
-
-    auto beginAddr = mImage->cur();
-
-    auto inheritIndicatorValue = mImage->read<intptr_t>() - sizeof(std::type_info);
-
-    std::string inheritIndicatorName;
-    if (mPrepared.mExternalSymbolPosition.contains(beginAddr)) {
-        inheritIndicatorName = mPrepared.mExternalSymbolPosition.at(beginAddr);
-    } else if (auto inheritIndicator = mImage->lookupSymbol(inheritIndicatorValue)) {
-        inheritIndicatorName = inheritIndicator->name();
-    } else {
-        spdlog::warn("Failed to reading type info at {:#x}. [CURRENT_IS_NOT_TYPEINFO]", beginAddr);
-        return nullptr;
-    }
-    // spdlog::debug("Processing: {:#x}", beginAddr);
-    if (inheritIndicatorName == _constant.SYM_CLASS_INFO) {
-        auto result   = std::make_unique<NoneInheritTypeInfo>();
-        result->mName = _readZTS();
-        if (result->mName.empty()) {
-            spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
-            return nullptr;
-        }
-        return result;
-    }
-    if (inheritIndicatorName == _constant.SYM_SI_CLASS_INFO) {
-        auto result         = std::make_unique<SingleInheritTypeInfo>();
-        result->mName       = _readZTS();
-        result->mOffset     = 0x0;
-        result->mParentType = _readZTI();
-        if (result->mName.empty() || result->mParentType.empty()) {
-            spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
-            return nullptr;
-        }
-        return result;
-    }
-    if (inheritIndicatorName == _constant.SYM_VMI_CLASS_INFO) {
-        auto result   = std::make_unique<MultipleInheritTypeInfo>();
-        result->mName = _readZTS();
-        if (result->mName.empty()) {
-            spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
-            return nullptr;
-        }
-        result->mAttribute = mImage->read<unsigned int>();
-        auto baseCount     = mImage->read<unsigned int>();
-        for (unsigned int idx = 0; idx < baseCount; idx++) {
-            BaseClassInfo baseInfo;
-            baseInfo.mName = _readZTI();
-            if (baseInfo.mName.empty()) {
-                spdlog::warn("Failed to reading type info at {:#x}. [ABNORMAL_SYMBOL_VALUE]", mImage->last());
-                return nullptr;
-            }
-            auto flag        = mImage->read<long long>();
-            baseInfo.mOffset = (flag >> 8) & 0xFF;
-            baseInfo.mMask   = flag & 0xFF;
-            result->mBaseClasses.emplace_back(baseInfo);
-        }
-        return result;
-    }
-    // spdlog::warn("Failed to reading type info at {:#x}. [UNKNOWN_INHERIT_TYPE]", beginAddr);
-    return nullptr;
-}
-
 void ItaniumVTableReader::printDebugString(const VTable& pTable) {
     spdlog::info("VTable: {}", pTable.mName);
     for (auto& i : pTable.mSubTables) {
@@ -291,71 +547,78 @@ void ItaniumVTableReader::printDebugString(const VTable& pTable) {
 
 void ItaniumVTableReader::_prepareData() {
     if (!mImage->isValid()) return;
-    if (dynamic_cast<format::ELF*>(mImage.get())) {
-        auto elfImage = (LIEF::ELF::Binary*)mImage->getImage();
-        for (auto& symbol : elfImage->symtab_symbols()) {
-            if (symbol.name().starts_with(_constant.PREFIX_VTABLE)) {
-                mPrepared.mVTableBegins.emplace(symbol.value());
-            } else if (symbol.name().starts_with(_constant.PREFIX_TYPEINFO)) {
-                mPrepared.mTypeInfoBegins.emplace(symbol.value());
-            }
-        }
-        for (auto& relocation : elfImage->dynamic_relocations()) {
-            if (!relocation.has_symbol()) return;
-            auto name = relocation.symbol()->name();
-            if (name == _constant.SYM_CLASS_INFO || name == _constant.SYM_SI_CLASS_INFO
-                || name == _constant.SYM_VMI_CLASS_INFO) {
-                mPrepared.mTypeInfoBegins.emplace(relocation.address());
+    if (auto elf = dynamic_cast<format::ELF*>(mImage.get())) {
+        auto                             elfImage = elf->getImage();
+        std::vector<const LIEF::Symbol*> symbols;
+        symbols.reserve(elfImage->symtab_symbols().size());
+        for (auto& symbol : elfImage->symtab_symbols()) symbols.emplace_back(&symbol);
+        _collectBegins(symbols);
+        for (auto& relocation : elf->getRelocations()) {
+            auto symbol = elf->getDynSymbol(relocation.mSymbol);
+            if (!symbol) continue;
+            auto& name = symbol->name();
+            _classifyImport(relocation.mAddress, name);
+            // Undefined, the relocated value is only a placeholder address.
+            if (!symbol->value() && !name.empty()) {
+                mPrepared.mExternalSymbolPosition.try_emplace(relocation.mAddress, name);
             }
         }
         return;
     }
-    if (dynamic_cast<format::MachO*>(mImage.get())) {
-        auto machoImage = (LIEF::MachO::Binary*)mImage->getImage();
+    if (auto macho = dynamic_cast<format::MachO*>(mImage.get())) {
+        auto machoImage = macho->getImage();
+        auto addBind    = [&](uintptr_t pAddress, const std::string& pName) {
+            _classifyImport(pAddress, pName);
+            mPrepared.mExternalSymbolPosition.try_emplace(pAddress, pName);
+        };
         if (auto dyldInfo = machoImage->dyld_info()) {
             for (auto& bind : dyldInfo->bindings()) {
-                if (!bind.has_symbol()) continue;
-                auto name = bind.symbol()->name();
-                if (name == _constant.SYM_CLASS_INFO || name == _constant.SYM_SI_CLASS_INFO
-                    || name == _constant.SYM_VMI_CLASS_INFO) {
-                    mPrepared.mTypeInfoBegins.emplace(bind.address());
-                }
-                mPrepared.mExternalSymbolPosition.try_emplace(bind.address(), name);
+                if (bind.has_symbol()) addBind(bind.address(), bind.symbol()->name());
             }
         }
-        for (auto& symbol : machoImage->symbols()) {
-            if (symbol.name().starts_with(_constant.PREFIX_VTABLE)) {
-                mPrepared.mVTableBegins.emplace(symbol.value());
-            } else if (symbol.name().starts_with(_constant.PREFIX_TYPEINFO)) {
-                mPrepared.mTypeInfoBegins.emplace(symbol.value());
-            }
+        // Newer images have no dyld info, their binds are in the pointer chains.
+        for (auto& fixup : macho->getChainedFixups()) {
+            if (fixup.mImport == format::MachO::ChainedFixup::NO_IMPORT) continue;
+            addBind(fixup.mAddress, macho->getChainedImports()[fixup.mImport]);
         }
+        std::vector<const LIEF::Symbol*> symbols;
+        symbols.reserve(machoImage->symbols().size());
+        for (auto& symbol : machoImage->symbols()) symbols.emplace_back(&symbol);
+        _collectBegins(symbols);
         return;
     }
 }
 
-void ItaniumVTableReader::printDebugString(const std::unique_ptr<TypeInfo>& pType) {
-    if (!pType) return;
-    spdlog::info("TypeInfo: {}", pType->mName);
-    switch (pType->kind()) {
+void ItaniumVTableReader::_collectBegins(const std::vector<const LIEF::Symbol*>& pSymbols) {
+    auto withPrefix = [&](const std::string& pPrefix) {
+        return [&](size_t pIndex) -> std::optional<uintptr_t> {
+            if (!pSymbols[pIndex]->name().starts_with(pPrefix)) return std::nullopt;
+            return pSymbols[pIndex]->value();
+        };
+    };
+    mPrepared.mVTableBegins.build(pSymbols.size(), withPrefix(_constant.PREFIX_VTABLE));
+    mPrepared.mTypeInfoBegins.build(pSymbols.size(), withPrefix(_constant.PREFIX_TYPEINFO));
+}
+
+void ItaniumVTableReader::printDebugString(const TypeInfoTable& pTable, const TypeInfo& pType) {
+    spdlog::info("TypeInfo: {}", pTable.getName(pType.mName));
+    switch (pType.mKind) {
     case TypeInheritKind::None:
         spdlog::info("\tInherit: None");
         break;
-    case TypeInheritKind::Single: {
+    case TypeInheritKind::Single:
         spdlog::info("\tInherit: Single");
-        auto typeInfo = (SingleInheritTypeInfo*)pType.get();
-        spdlog::info("\tParentType: {}", typeInfo->mParentType);
-        spdlog::info("\tOffset: {:#x}", typeInfo->mOffset);
+        spdlog::info("\tParentType: {}", pTable.getName(pType.mParentType));
+        spdlog::info("\tOffset: {:#x}", pType.mOffset);
         break;
-    }
     case TypeInheritKind::Multiple: {
         spdlog::info("\tInherit: Multiple");
-        auto typeInfo = (MultipleInheritTypeInfo*)pType.get();
-        spdlog::info("\tAttribute: {:#x}", typeInfo->mAttribute);
-        spdlog::info("\tBase classes ({}):", typeInfo->mBaseClasses.size());
-        for (auto& base : typeInfo->mBaseClasses) {
+        auto bases = pTable.getBases(pType);
+        spdlog::info("\tAttribute: {:#x}", pType.mAttribute);
+        spdlog::info("\tBase classes ({}):", bases.size());
+        for (auto& base : bases) {
             spdlog::info("\t\tOffset: {:#x}", base.mOffset);
-            spdlog::info("\t\t\tName: {}", base.mName);
+            spdlog::info("\t\t\tName: {}", pTable.getName(base.mName));
             spdlog::info("\t\t\tMask: {:#x}", base.mMask);
         }
         break;
@@ -373,10 +636,7 @@ JSON DumpVFTableResult::toJson() const {
 
 JSON DumpTypeInfoResult::toJson() const {
     JSON ret;
-    for (auto& type : mTypeInfo) {
-        if (!type) continue;
-        ret[type->mName] = type->toJson();
-    }
+    for (auto& type : mTypeInfo) ret[mTypeInfo.getName(type.mName)] = mTypeInfo.toJson(type);
     return ret;
 }
 
@@ -5,6 +5,11 @@
 #include "base/Base.h"
 #include "base/Executable.h"
 
+#include "format/DependencyScope.h"
+
+#include "util/AddressSet.h"
+
+#include <functional>
 #include <unordered_set>
 
 METADUMPER_ABI_ITANIUM_BEGIN
@@ -17,32 +22,84 @@ struct DumpVFTableResult {
 };
 
 struct DumpTypeInfoResult {
-    unsigned int                           mTotal{};
-    unsigned int                           mParsed{};
-    std::vector<std::unique_ptr<TypeInfo>> mTypeInfo;
-    nlohmann::json                         toJson() const;
+    unsigned int   mTotal{};
+    unsigned int   mParsed{};
+    TypeInfoTable  mTypeInfo;
+    nlohmann::json toJson() const;
+};
+
+// Bounds of a single vtable walk, so that a corrupted or oddly laid-out table can't run away. A table exceeding them
+// is skipped and reported as [SLOT_LIMIT], [SUB_TABLE_LIMIT] or [SECTION_END], the end of the section it starts in.
+struct VTableLimits {
+    unsigned int mMaxSlots{16384};
+    unsigned int mMaxSubTables{256};
 };
 
 class ItaniumVTableReader {
 public:
     explicit ItaniumVTableReader(const std::shared_ptr<Executable>& image);
+    ~ItaniumVTableReader();
+
+    void setLimits(const VTableLimits& pLimits) { mLimits = pLimits; }
+
+    // Resolves external slots to the library defining them, ELF only.
+    void setDependencies(std::shared_ptr<const format::DependencyScope> pDependencies) {
+        mDependencies = std::move(pDependencies);
+    }
 
     DumpVFTableResult  dumpVFTable();
     DumpTypeInfoResult dumpTypeInfo();
 
+    // Streaming variants, each entry is handed over as soon as it is decoded. Vtables are not kept in the result,
+    // typeinfos are (they are flat records).
+    DumpVFTableResult  dumpVFTable(const std::function<void(VTable&&)>& pCallback);
+    DumpTypeInfoResult dumpTypeInfo(const std::function<void(const TypeInfoTable&, const TypeInfo&)>& pCallback);
+    // Same order, along with the address each vtable begins at, e.g. to read it again with readVTableAt().
+    DumpVFTableResult  dumpVFTableBegins(const std::function<void(uintptr_t, VTable&&)>& pCallback);
+
+    // On-demand access, used by the library API.
+
+    std::optional<VTable> readVTableAt(uintptr_t pVAddr);
+    // Appended to pTable, nullptr if it failed to decode.
+    const TypeInfo*       readTypeInfoAt(uintptr_t pVAddr, TypeInfoTable& pTable);
+
+    // Sorted. Without symbol table, vtables are discovered by a full scan on the first call.
+    std::vector<uintptr_t> getVTableBegins();
+    std::vector<uintptr_t> getTypeInfoBegins() const;
+
+    [[nodiscard]] const std::string& getVTablePrefix() const { return _constant.PREFIX_VTABLE; }
+    [[nodiscard]] const std::string& getTypeInfoPrefix() const { return _constant.PREFIX_TYPEINFO; }
+
     static void printDebugString(const VTable& pTable);
-    static void printDebugString(const std::unique_ptr<TypeInfo>& pType);
+    static void printDebugString(const TypeInfoTable& pTable, const TypeInfo& pType);
 
 private:
-    void _prepareData();
+    // Everything that reads target pointers, specialized per TargetTraits. The target is picked once, so the inner
+    // loops don't branch on it.
+    class Decoder;
+    template <typename Traits>
+    class DecoderImpl;
 
-    std::optional<VTable>     readVTable();
-    std::unique_ptr<TypeInfo> readTypeInfo();
+    void _prepareData();
+    // Vtable and typeinfo symbols, classified in parallel, then inserted shard by shard in parallel.
+    void _collectBegins(const std::vector<const LIEF::Symbol*>& pSymbols);
 
-    std::string _readZTS();
-    std::string _readZTI();
+    std::optional<std::string> _lookupSymbolName(uintptr_t pVAddr);
+    VTableColumn               _resolveExternal(std::string_view pSymbol) const;
 
     void _initFormatConstants();
+    // Binds of typeinfos to the vtable of their __cxxabiv1 class.
+    void _classifyImport(uintptr_t pAddress, const std::string& pName);
+    // Local __cxxabiv1 vtables and __cxa_pure_virtual, once _prepareData() is done.
+    void _resolveRuntimeSymbols();
+
+    // The __cxxabiv1 class of a typeinfo, what its vptr points into.
+    enum class TypeInfoKind : uint8_t {
+        Class,                      // __class_type_info
+        SingleInheritance,          // __si_class_type_info
+        VirtualMultipleInheritance, // __vmi_class_type_info
+        Other,                      // pointers, fundamentals, functions... not classes.
+    };
 
     struct FormatConstants {
         std::string SEGMENT_TEXT;
@@ -50,21 +107,37 @@ private:
         std::string SEGMENT_READONLY_DATA;
         std::string PREFIX_VTABLE;
         std::string PREFIX_TYPEINFO;
-        std::string SYM_CLASS_INFO;
-        std::string SYM_SI_CLASS_INFO;
-        std::string SYM_VMI_CLASS_INFO;
+        std::string PREFIX_CXXABI_VTABLE;
         std::string SYM_PURE_VFN;
+        // Vtable name -> kind, for every __cxxabiv1 type_info class.
+        std::unordered_map<std::string, TypeInfoKind> TYPE_INFO_VTABLES;
     } _constant;
 
     struct PreparedData {
-        std::unordered_set<uintptr_t> mVTableBegins;
-        std::unordered_set<uintptr_t> mTypeInfoBegins;
-        // Fake symbol mapping.
-        // TODO: save memory...
-        std::unordered_map<uintptr_t, std::string> mExternalSymbolPosition;
+        util::AddressSet mVTableBegins;
+        util::AddressSet mTypeInfoBegins;
+        // Fake symbol mapping: bound address -> imported name, owned by the image (LIEF's symbols, chained imports).
+        std::unordered_map<uintptr_t, std::string_view> mExternalSymbolPosition;
+        // Filled by getVTableBegins() if there is no symbol table.
+        std::optional<std::vector<uintptr_t>> mScannedVTableBegins;
+        // Typeinfo -> data words pointing to it, seeds the vtable scan without symbol table.
+        std::optional<std::unordered_map<uintptr_t, std::vector<uintptr_t>>> mTypeInfoReferences;
+        // Filled along with it: words starting "0, 0, function", vtables without typeinfo.
+        std::vector<uintptr_t> mUntypedVTableCandidates;
+        // Typeinfo kinds by typeinfo address, for those bound to an imported __cxxabiv1 vtable.
+        std::unordered_map<uintptr_t, TypeInfoKind> mTypeInfoKindOfImport;
+        // Typeinfo kinds by vtable address (vptr minus the type_info offset), for local __cxxabiv1 vtables. A handful,
+        // a linear search is a few integer comparisons.
+        std::vector<std::pair<uintptr_t, TypeInfoKind>> mTypeInfoKindOfVTable;
+        // Slot of a local __cxa_pure_virtual, as readVTable() would resolve it.
+        std::optional<VTableColumn> mPureVirtual;
     } mPrepared;
 
+    VTableLimits                                   mLimits;
+    std::shared_ptr<const format::DependencyScope> mDependencies;
+
     std::shared_ptr<Executable> mImage;
+    std::unique_ptr<Decoder>    mDecoder;
 };
 
 METADUMPER_ABI_ITANIUM_END
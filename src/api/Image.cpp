@@ -0,0 +1,134 @@
+#include "Image.h"
+
+#include "format/ELF.h"
+#include "format/MachO.h"
+#include "util/MagicHelper.h"
+
+METADUMPER_BEGIN
+
+using namespace abi::itanium;
+
+std::unique_ptr<Image> open(const std::string& pPath, size_t pMemoryBudget) {
+    // Read once, then shared by the magic detection, LIEF and the Loader.
+    auto file = std::make_shared<MappedFile>(pPath);
+    if (!file->isValid()) {
+        spdlog::error("Unable to load input file.");
+        return nullptr;
+    }
+
+    std::shared_ptr<Executable> executable;
+
+    switch (MagicHelper(*file).judgeFileType()) {
+    case Magic::ELF:
+        executable = std::make_shared<format::ELF>(file, pMemoryBudget);
+        break;
+    case Magic::MACHO_32:
+    case Magic::MACHO_64:
+        executable = std::make_shared<format::MachO>(file, pMemoryBudget);
+        break;
+    case Magic::PE:
+    case Magic::UNKNOWN:
+    default:
+        spdlog::error("Unsupported file type.");
+        return nullptr;
+    }
+
+    if (!executable->isValid()) return nullptr;
+    // What LIEF touched while parsing (it works on its own copy), from now on pages are only copied out on demand.
+    if (pMemoryBudget) file->release(0, file->size());
+
+    return std::make_unique<Image>(std::move(executable));
+}
+
+Image::Image(std::shared_ptr<Executable> pExecutable)
+: mExecutable(std::move(pExecutable)),
+  mReader(mExecutable),
+  mTypeInfoBegins(mReader.getTypeInfoBegins()) {}
+
+const VTable* Image::findVTable(const std::string& pName) {
+    std::lock_guard lock(mMutex);
+    if (auto it = mVTableByName.find(pName); it != mVTableByName.end()) return _decodeVTable(it->second);
+    if (auto symbol = mExecutable->lookupSymbol(pName); symbol && symbol->value()) {
+        auto vtable = _decodeVTable(symbol->value());
+        if (vtable && vtable->mName == pName) return vtable;
+    }
+    // No (usable) symbol, the name is only known after decoding.
+    _decodeAllVTables();
+    if (auto it = mVTableByName.find(pName); it != mVTableByName.end()) return _decodeVTable(it->second);
+    return nullptr;
+}
+
+const TypeInfo* Image::findTypeInfo(const std::string& pName) {
+    std::lock_guard lock(mMutex);
+    _decodeAllTypeInfos();
+    auto idx = mTypeInfos.find(pName);
+    return idx != TypeInfoTable::INVALID ? &mTypeInfos[idx] : nullptr;
+}
+
+const VTable* Image::getVTableAt(uintptr_t pVAddr) {
+    std::lock_guard lock(mMutex);
+    return _decodeVTable(pVAddr);
+}
+
+const TypeInfo* Image::getTypeInfoAt(uintptr_t pVAddr) {
+    std::lock_guard lock(mMutex);
+    _decodeAllTypeInfos();
+    auto it = mTypeInfoAt.find(pVAddr);
+    return it != mTypeInfoAt.end() ? &mTypeInfos[it->second] : nullptr;
+}
+
+Image::Range<VTable> Image::vtables() {
+    std::lock_guard lock(mMutex);
+    if (!mHasVTableBegins) {
+        mVTableBegins    = mReader.getVTableBegins();
+        mHasVTableBegins = true;
+    }
+    return {this, mVTableBegins};
+}
+
+const TypeInfoTable& Image::typeInfos() {
+    std::lock_guard lock(mMutex);
+    _decodeAllTypeInfos();
+    return mTypeInfos;
+}
+
+const TypeHierarchy& Image::getHierarchy() {
+    std::lock_guard lock(mMutex);
+    if (!mHierarchy) mHierarchy = std::make_unique<TypeHierarchy>(typeInfos());
+    return *mHierarchy;
+}
+
+const VTable* Image::_decodeVTable(uintptr_t pVAddr) {
+    if (auto it = mVTables.find(pVAddr); it != mVTables.end()) return it->second ? &*it->second : nullptr;
+    std::optional<VTable> vtable;
+    try {
+        vtable = mReader.readVTableAt(pVAddr);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+    }
+    auto& ret = mVTables.try_emplace(pVAddr, std::move(vtable)).first->second;
+    if (!ret) return nullptr;
+    mVTableByName.try_emplace(ret->mName, pVAddr);
+    return &*ret;
+}
+
+void Image::_decodeAllVTables() {
+    if (mAllVTablesDecoded) return;
+    for (auto& vtable : vtables()) (void)vtable;
+    mAllVTablesDecoded = true;
+}
+
+void Image::_decodeAllTypeInfos() {
+    if (mAllTypeInfosDecoded) return;
+    for (auto addr : mTypeInfoBegins) {
+        try {
+            if (!mReader.readTypeInfoAt(addr, mTypeInfos)) continue;
+            mTypeInfoAt.try_emplace(addr, (uint32_t)mTypeInfos.size() - 1);
+        } catch (const std::runtime_error& e) {
+            spdlog::error(e.what());
+        }
+    }
+    mAllTypeInfosDecoded = true;
+}
+
+METADUMPER_END
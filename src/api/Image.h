@@ -0,0 +1,132 @@
+#pragma once
+
+#include "base/Base.h"
+#include "base/Executable.h"
+
+#include "abi/itanium/ItaniumTypeHierarchy.h"
+#include "abi/itanium/ItaniumVTableReader.h"
+
+#include <mutex>
+
+METADUMPER_BEGIN
+
+// Public entry point of libcppmetadumper.
+//
+//   auto image = metadumper::open("libsample.so");
+//   if (auto vtable = image->findVTable("_ZTV6Player")) { ... }
+//   for (auto& type : image->typeInfos()) { ... }
+//
+// Nothing is decoded up front. Every vtable is decoded the first time it is touched and then cached, the typeinfos
+// (flat records, see TypeInfoTable) all at once the first time any of them is.
+// Returned pointers stay valid for the lifetime of the image. All methods are thread-safe.
+class Image {
+public:
+    template <typename T>
+    class Range;
+
+    explicit Image(std::shared_ptr<Executable> pExecutable);
+
+    const abi::itanium::VTable*   findVTable(const std::string& pName);
+    const abi::itanium::TypeInfo* findTypeInfo(const std::string& pName);
+
+    const abi::itanium::VTable*   getVTableAt(uintptr_t pVAddr);
+    const abi::itanium::TypeInfo* getTypeInfoAt(uintptr_t pVAddr); // one of the typeinfos found in the image.
+
+    Range<abi::itanium::VTable> vtables();
+    // Also resolves the names of the records.
+    const abi::itanium::TypeInfoTable& typeInfos();
+
+    // Built on first use, decodes every typeinfo.
+    const abi::itanium::TypeHierarchy& getHierarchy();
+
+    [[nodiscard]] std::shared_ptr<Executable> getExecutable() const { return mExecutable; }
+
+    // Not thread-safe, meant for the all-at-once dumps.
+    abi::itanium::ItaniumVTableReader& getReader() { return mReader; }
+
+private:
+    const abi::itanium::VTable* _decodeVTable(uintptr_t pVAddr);
+
+    void _decodeAllVTables();
+    void _decodeAllTypeInfos();
+
+    std::shared_ptr<Executable>       mExecutable;
+    abi::itanium::ItaniumVTableReader mReader;
+
+    std::recursive_mutex mMutex;
+
+    std::vector<uintptr_t> mVTableBegins;
+    std::vector<uintptr_t> mTypeInfoBegins;
+    bool                   mHasVTableBegins{};
+
+    // nullopt marks an address that failed to decode.
+    std::unordered_map<uintptr_t, std::optional<abi::itanium::VTable>> mVTables;
+
+    // Immutable once decoded.
+    abi::itanium::TypeInfoTable             mTypeInfos;
+    std::unordered_map<uintptr_t, uint32_t> mTypeInfoAt; // record index
+
+    std::unordered_map<std::string, uintptr_t> mVTableByName;
+    bool                                       mAllVTablesDecoded{};
+    bool                                       mAllTypeInfosDecoded{};
+
+    std::unique_ptr<abi::itanium::TypeHierarchy> mHierarchy;
+};
+
+// Lazily decoding view over every vtable of an image, entries that fail to decode are skipped.
+template <typename T>
+class Image::Range {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T*;
+        using reference         = const T&;
+
+        Iterator(const Range* pRange, size_t pIndex) : mRange(pRange), mIndex(pIndex) { _settle(); }
+
+        reference operator*() const { return *mCurrent; }
+        pointer   operator->() const { return mCurrent; }
+
+        Iterator& operator++() {
+            mIndex++;
+            _settle();
+            return *this;
+        }
+
+        bool operator==(const Iterator& pOther) const { return mIndex == pOther.mIndex; }
+
+    private:
+        // Advance to the next entry that decodes.
+        void _settle() {
+            for (mCurrent = nullptr; mIndex < mRange->mBegins.size(); mIndex++) {
+                if ((mCurrent = mRange->decode(mRange->mBegins[mIndex]))) break;
+            }
+        }
+
+        const Range* mRange;
+        size_t       mIndex;
+        pointer      mCurrent{};
+    };
+
+    Range(Image* pImage, const std::vector<uintptr_t>& pBegins) : mImage(pImage), mBegins(pBegins) {}
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, mBegins.size()); }
+
+    [[nodiscard]] size_t capacity() const { return mBegins.size(); }
+
+private:
+    const T* decode(uintptr_t pVAddr) const { return mImage->getVTableAt(pVAddr); }
+
+    Image*                        mImage;
+    const std::vector<uintptr_t>& mBegins;
+};
+
+// Detects the file format and loads the image, returns nullptr if it is not supported.
+// With a memory budget (in bytes), the file is read in pages on demand instead of at once.
+std::unique_ptr<Image> open(const std::string& pPath, size_t pMemoryBudget = 0);
+
+METADUMPER_END
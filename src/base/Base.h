@@ -22,6 +22,15 @@
 #define METADUMPER_UTIL_BEGIN   METADUMPER_BEGIN namespace util {
 #define METADUMPER_UTIL_END     METADUMPER_END }
 
+#define METADUMPER_SERVER_BEGIN METADUMPER_BEGIN namespace server {
+#define METADUMPER_SERVER_END   METADUMPER_END   }
+
+#define METADUMPER_OUTPUT_BEGIN METADUMPER_BEGIN namespace output {
+#define METADUMPER_OUTPUT_END   METADUMPER_END   }
+
+#define METADUMPER_BENCH_BEGIN  METADUMPER_BEGIN namespace bench {
+#define METADUMPER_BENCH_END    METADUMPER_END   }
+
 // string
 
 #define METADUMPER_UTIL_STRING_BEGIN   METADUMPER_UTIL_BEGIN namespace string {
@@ -12,7 +12,8 @@ METADUMPER_BEGIN
 
 class Executable : public Loader {
 public:
-    explicit Executable(const std::string& pPath) : Loader(pPath) {};
+    explicit Executable(std::shared_ptr<MappedFile> pFile, size_t pMemoryBudget = 0)
+    : Loader(std::move(pFile), pMemoryBudget) {};
     virtual ~Executable() = default;
 
     [[nodiscard]] virtual uintptr_t getEndOfSections() const = 0;
@@ -23,7 +24,18 @@ public:
     virtual LIEF::Symbol* lookupSymbol(uintptr_t pVAddr)         = 0;
     virtual LIEF::Symbol* lookupSymbol(const std::string& pName) = 0;
 
+    // Symbol containing pVAddr, pOffset receives the distance from its start.
+    virtual LIEF::Symbol* lookupContainingSymbol(uintptr_t pVAddr, size_t& pOffset) = 0;
+
     virtual LIEF::Binary* getImage() const = 0;
+
+    // Of the target, see TargetTraits.h.
+    [[nodiscard]] size_t      getPointerSize() const { return mPointerSize; }
+    [[nodiscard]] std::endian getEndianness() const { return mEndianness; }
+
+protected:
+    size_t      mPointerSize{sizeof(uint64_t)};
+    std::endian mEndianness{std::endian::little};
 };
 
 METADUMPER_END
@@ -1,20 +1,17 @@
 #include "Loader.h"
 
-#include <fstream>
+#include <cstring>
 
 METADUMPER_BEGIN
 
-Loader::Loader(const std::string& pPath) {
-    std::ifstream file;
-    file.open(pPath, std::ios::binary);
-    if (!file.is_open()) {
-        spdlog::error("Failed to open file.");
+Loader::Loader(std::shared_ptr<MappedFile> pFile, size_t pMemoryBudget) : mFile(std::move(pFile)) {
+    if (!mFile || !mFile->isValid()) {
         mIsValid = false;
         return;
     }
-    file.seekg(0, std::ios::beg); // ...what the fucking
-    mStream << file.rdbuf();
-    file.close();
+    mData = mFile->data();
+    mSize = mData.size();
+    if (pMemoryBudget) mMaxPages = std::max<size_t>(pMemoryBudget / 2 / PAGE_SIZE, 4);
 }
 
 bool Loader::isValid() const { return mIsValid; }
@@ -39,4 +36,80 @@ std::string Loader::readCString(uintptr_t pVAddr, size_t pMaxLength) {
     return result;
 }
 
+void Loader::reload() {
+    if (!mMaxPages) {
+        onLoad(0, mData);
+        return;
+    }
+    for (auto idx : mUsedPages) mPages.erase(idx);
+    mUsedPages.clear();
+}
+
+void Loader::_read(void* pData, size_t pSize) {
+    if (mPos < 0 || mPos + pSize > mSize) throw std::runtime_error("BinaryStream is broken.");
+    if (!mMaxPages) {
+        std::memcpy(pData, mData.data() + mPos, pSize);
+        mPos += (intptr_t)pSize;
+        return;
+    }
+    auto dest = (char*)pData;
+    while (pSize) {
+        auto& page   = _getPage(mPos / PAGE_SIZE);
+        auto  offset = mPos % PAGE_SIZE;
+        auto  size   = std::min(pSize, PAGE_SIZE - offset);
+        std::memcpy(dest, page.mData.data() + offset, size);
+        dest  += size;
+        mPos  += (intptr_t)size;
+        pSize -= size;
+    }
+}
+
+void Loader::_write(const void* pData, size_t pSize) {
+    if (mPos < 0 || mPos + pSize > mSize) throw std::runtime_error("BinaryStream is broken.");
+    if (!mMaxPages) {
+        std::memcpy(mData.data() + mPos, pData, pSize);
+        mPos += (intptr_t)pSize;
+        return;
+    }
+    auto src = (const char*)pData;
+    while (pSize) {
+        auto& page   = _getPage(mPos / PAGE_SIZE);
+        auto  offset = mPos % PAGE_SIZE;
+        auto  size   = std::min(pSize, PAGE_SIZE - offset);
+        std::memcpy(page.mData.data() + offset, src, size);
+        if (!page.mIsDirty) {
+            page.mIsDirty = true;
+            mUsedPages.erase(page.mUsed);
+        }
+        src   += size;
+        mPos  += (intptr_t)size;
+        pSize -= size;
+    }
+}
+
+Loader::Page& Loader::_getPage(size_t pIndex) {
+    if (auto it = mPages.find(pIndex); it != mPages.end()) {
+        auto& page = it->second;
+        if (!page.mIsDirty) mUsedPages.splice(mUsedPages.begin(), mUsedPages, page.mUsed);
+        return page;
+    }
+
+    while (!mUsedPages.empty() && mUsedPages.size() >= mMaxPages) {
+        mPages.erase(mUsedPages.back());
+        mUsedPages.pop_back();
+    }
+
+    // The mapping itself stays untouched, onLoad() applies to the copy. Its pages are dropped right away, so only the
+    // copies count against the budget.
+    auto  offset = pIndex * PAGE_SIZE;
+    auto  source = mData.subspan(offset, std::min(PAGE_SIZE, mSize - offset));
+    auto& page   = mPages[pIndex];
+    page.mData.assign(source.begin(), source.end());
+    mFile->release(offset, source.size());
+    onLoad(offset, page.mData);
+    mUsedPages.emplace_front(pIndex);
+    page.mUsed = mUsedPages.begin();
+    return page;
+}
+
 METADUMPER_END
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Base.h"
+#include "MappedFile.h"
+#include "TargetTraits.h"
+
+#include <list>
+#include <span>
 
 METADUMPER_BEGIN
 
@@ -8,7 +13,9 @@ enum RelativePos { Begin, Current, End };
 
 class Loader {
 public:
-    explicit Loader(const std::string& pPath);
+    // Without a memory budget the mapping is used in place. Otherwise fixed-size pages are copied out of it on demand,
+    // and the least recently used ones are dropped to stay within half of the budget.
+    explicit Loader(std::shared_ptr<MappedFile> pFile, size_t pMemoryBudget = 0);
     virtual ~Loader() = default;
 
     [[nodiscard]] bool isValid() const;
@@ -20,12 +27,18 @@ public:
         T    value;
         auto offset = getGapInFront(cur()); // Adjust file offset to fit in-memory position.
         move(-offset);
-        mStream.read((char*)&value, sizeof(T));
+        _read(&value, sizeof(T));
         move(offset);
         mLastOperated = sizeof(T);
         return value;
     };
 
+    // Target data, converted to host byte order.
+    template <typename Traits, typename T = typename Traits::Pointer>
+    [[nodiscard]] T readAs() {
+        return toHost<Traits>(read<T>());
+    }
+
     template <typename T, bool KeepOriPos>
     [[nodiscard]] T read(uintptr_t pVAddr) {
         pVAddr -= getImageBase(); // Adjust the in-memory position to file-offset.
@@ -59,13 +72,13 @@ public:
         }
         move(pVAddr, Begin);
         // inlined from unaddressed write.
-        mStream.write(reinterpret_cast<char*>(&pData), sizeof(T));
+        _write(&pData, sizeof(T));
         mLastOperated = sizeof(T);
     }
 
     // Position
 
-    inline uintptr_t cur() { return mStream.tellg() + getImageBase(); }
+    inline uintptr_t cur() { return mPos + getImageBase(); }
 
     inline uintptr_t last() { return cur() - mLastOperated; }
 
@@ -75,9 +88,9 @@ public:
 
     inline bool move(intptr_t pVal, RelativePos pRel = Current) {
         if (pVal && pRel == Begin) pVal -= getImageBase();
-        mStream.seekp(pVal, (std::ios_base::seekdir)pRel);
-        mStream.seekg(pVal, (std::ios_base::seekdir)pRel);
-        if (!mStream.good()) throw std::runtime_error("BinaryStream is broken.");
+        auto pos = pVal + (pRel == Begin ? 0 : pRel == Current ? mPos : (intptr_t)mSize);
+        if (pos < 0 || pos > (intptr_t)mSize) throw std::runtime_error("BinaryStream is broken.");
+        mPos = pos;
         return true;
     }
 
@@ -93,10 +106,35 @@ protected:
 
     virtual intptr_t getImageBase() const { return 0; };
 
+    // Called for every part of the file brought into memory (the whole mapping at once without a memory budget),
+    // before anything is read from it. pOffset is a file offset.
+    virtual void onLoad(size_t pOffset, std::span<char> pData) {}
+
+    // Makes onLoad() apply again to everything read from now on, e.g. once the relocations are known.
+    void reload();
+
 private:
-    std::stringstream mStream;
+    static constexpr size_t PAGE_SIZE = 64 * 1024;
+
+    struct Page {
+        std::vector<char>           mData;
+        std::list<size_t>::iterator mUsed;      // in mUsedPages, unless dirty.
+        bool                        mIsDirty{}; // written, so it can't be dropped.
+    };
+
+    void  _read(void* pData, size_t pSize);
+    void  _write(const void* pData, size_t pSize);
+    Page& _getPage(size_t pIndex);
+
+    std::shared_ptr<MappedFile> mFile;
+    std::span<char>             mData; // Whole file.
+    size_t                      mSize{};
+    intptr_t                    mPos{};
+    size_t                      mLastOperated{};
 
-    size_t mLastOperated{};
+    size_t                           mMaxPages{};
+    std::unordered_map<size_t, Page> mPages;
+    std::list<size_t>                mUsedPages; // Clean pages, most recently used first.
 };
 
 METADUMPER_END
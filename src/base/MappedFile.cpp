@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+METADUMPER_BEGIN
+
+#ifndef _WIN32
+
+MappedFile::MappedFile(const std::string& pPath) : mPath(pPath) {
+    auto fd = ::open(pPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        spdlog::error("Failed to open file.");
+        return;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) < 0) {
+        spdlog::error("Failed to open file.");
+        ::close(fd);
+        return;
+    }
+    mSize = (size_t)info.st_size;
+    if (mSize) {
+        auto data = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            spdlog::error("Failed to map file.");
+            ::close(fd);
+            return;
+        }
+        mData     = (char*)data;
+        mIsMapped = true;
+    }
+    ::close(fd); // The mapping keeps the file alive.
+    mIsValid = true;
+}
+
+MappedFile::~MappedFile() {
+    if (mIsMapped) munmap(mData, mSize);
+}
+
+void MappedFile::release(size_t pOffset, size_t pSize) {
+    if (!mIsMapped || pOffset >= mSize) return;
+    static const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    // Down to a page boundary, the pages before are clean as well.
+    auto begin = pOffset / pageSize * pageSize;
+    auto end   = std::min(mSize, pOffset + pSize);
+    madvise(mData + begin, end - begin, MADV_DONTNEED);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& pPath) : mPath(pPath) {
+    std::ifstream file(pPath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open file.");
+        return;
+    }
+    mBuffer.resize((size_t)file.tellg());
+    file.seekg(0, std::ios::beg);
+    if (!file.read(mBuffer.data(), (std::streamsize)mBuffer.size())) {
+        spdlog::error("Failed to read file.");
+        return;
+    }
+    mData    = mBuffer.data();
+    mSize    = mBuffer.size();
+    mIsValid = true;
+}
+
+MappedFile::~MappedFile() = default;
+
+void MappedFile::release(size_t, size_t) {}
+
+#endif
+
+METADUMPER_END
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Base.h"
+
+#include <span>
+
+METADUMPER_BEGIN
+
+// The input file, opened once and shared by the magic detection, LIEF and the Loader.
+//
+// The mapping is private: what the Loader writes to it (relocations) is copy-on-write and never reaches the file, and
+// happens only after LIEF is done parsing. Where mmap is not available the file is read into memory once instead.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& pPath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool isValid() const { return mIsValid; }
+
+    [[nodiscard]] const std::string& getPath() const { return mPath; }
+    [[nodiscard]] size_t             size() const { return mSize; }
+
+    [[nodiscard]] std::span<char>          data() { return {mData, mSize}; }
+    [[nodiscard]] std::span<const uint8_t> bytes() const { return {(const uint8_t*)mData, mSize}; }
+
+    // Drops the resident pages of the range, they are read from the file again when touched. Only for ranges that
+    // were never written, their private changes would be lost. No-op without mmap.
+    void release(size_t pOffset, size_t pSize);
+
+private:
+    std::string mPath;
+    char*       mData{};
+    size_t      mSize{};
+    bool        mIsValid{};
+    bool        mIsMapped{};
+
+    std::vector<char> mBuffer; // Without mmap.
+};
+
+METADUMPER_END
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Base.h"
+
+#include <bit>
+#include <concepts>
+
+METADUMPER_BEGIN
+
+// Pointer width and byte order of the analyzed image, which may differ from the host's.
+template <std::unsigned_integral PointerT, std::endian EndianV>
+struct TargetTraits {
+    using Pointer = PointerT;                     // target uintptr_t
+    using Offset  = std::make_signed_t<PointerT>; // target ptrdiff_t, also `long` of ILP32 and LP64.
+
+    static constexpr size_t      POINTER_SIZE = sizeof(Pointer);
+    static constexpr std::endian ENDIAN       = EndianV;
+
+    // sizeof(std::type_info) of the target: vptr and __name.
+    static constexpr size_t TYPE_INFO_SIZE = 2 * POINTER_SIZE;
+};
+
+using Target32LE = TargetTraits<uint32_t, std::endian::little>;
+using Target32BE = TargetTraits<uint32_t, std::endian::big>;
+using Target64LE = TargetTraits<uint64_t, std::endian::little>;
+using Target64BE = TargetTraits<uint64_t, std::endian::big>;
+
+template <std::integral T>
+constexpr T byteswap(T pValue) {
+    auto value = (std::make_unsigned_t<T>)pValue;
+    std::make_unsigned_t<T> ret{};
+    for (size_t i = 0; i < sizeof(T); i++) {
+        ret   = (std::make_unsigned_t<T>)((ret << 8) | (value & 0xFF));
+        value = (std::make_unsigned_t<T>)(value >> 8);
+    }
+    return (T)ret;
+}
+
+// Converts between target and host byte order.
+template <typename Traits, std::integral T>
+constexpr T toHost(T pValue) {
+    if constexpr (Traits::ENDIAN != std::endian::native) return byteswap(pValue);
+    else return pValue;
+}
+
+// The single runtime dispatch: pFunc is called with a Traits tag, e.g. [&](auto pTraits) { using Traits = ...; }.
+template <typename Func>
+decltype(auto) dispatchTarget(size_t pPointerSize, std::endian pEndian, Func&& pFunc) {
+    if (pPointerSize == sizeof(uint32_t)) {
+        return pEndian == std::endian::big ? pFunc(Target32BE{}) : pFunc(Target32LE{});
+    }
+    return pEndian == std::endian::big ? pFunc(Target64BE{}) : pFunc(Target64LE{});
+}
+
+METADUMPER_END
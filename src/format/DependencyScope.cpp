@@ -0,0 +1,168 @@
+#include "DependencyScope.h"
+
+#include "util/Parallel.h"
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
+
+METADUMPER_FORMAT_BEGIN
+
+DependencyScope::DependencyScope(const std::string& pPath, const ELF& pImage, const Options& pOptions)
+: mOptions(pOptions) {
+    if (!mOptions.mSysroot.empty()) {
+        for (auto dir : {"/lib", "/usr/lib", "/lib64", "/usr/lib64"}) {
+            mDefaultPaths.emplace_back(mOptions.mSysroot + dir);
+        }
+    }
+    // e.g. libraries extracted side by side from an APK.
+    mDefaultPaths.emplace_back(std::filesystem::path(pPath).parent_path().string());
+
+    Library root;
+    root.mPath = pPath;
+    _readDynamic(*pImage.getImage(), root);
+
+    std::unordered_set<std::string>                     seen;
+    std::vector<std::pair<std::string, const Library*>> level; // DT_NEEDED name, requester.
+    for (auto& needed : root.mNeeded) {
+        if (seen.emplace(needed).second) level.emplace_back(needed, &root);
+    }
+
+    while (!level.empty()) {
+        std::vector<std::string> paths(level.size());
+        for (size_t idx = 0; idx < level.size(); idx++) {
+            auto path = _locate(level[idx].first, *level[idx].second);
+            if (path) paths[idx] = std::move(*path);
+            else spdlog::warn("Dependency {} not found.", level[idx].first);
+        }
+
+        std::vector<std::shared_ptr<const Library>> loaded(level.size());
+        util::parallelFor(
+            level.size(),
+            [&](size_t pIndex) {
+                if (!paths[pIndex].empty()) loaded[pIndex] = _load(paths[pIndex]);
+            },
+            mOptions.mThreads
+        );
+
+        std::vector<std::pair<std::string, const Library*>> nextLevel;
+        for (size_t idx = 0; idx < level.size(); idx++) {
+            auto& library = loaded[idx];
+            if (!library) {
+                if (!paths[idx].empty()) spdlog::warn("Failed to load dependency {}.", paths[idx]);
+                continue;
+            }
+            mNames.emplace_back(level[idx].first);
+            mLibraries.emplace_back(library);
+            for (auto& needed : library->mNeeded) {
+                if (seen.emplace(needed).second) nextLevel.emplace_back(needed, library.get());
+            }
+        }
+        level = std::move(nextLevel);
+    }
+
+    // First definition in load order wins.
+    for (uint32_t idx = 0; idx < mLibraries.size(); idx++) {
+        for (auto& [name, rva] : mLibraries[idx]->mExports) mSymbols.try_emplace(name, idx, rva);
+    }
+    spdlog::info("{:<12}{} librar(ies), {} symbol(s)", "Dependencies:", mLibraries.size(), mSymbols.size());
+}
+
+std::optional<DependencyScope::Definition> DependencyScope::find(std::string_view pSymbol) const {
+    auto it = mSymbols.find(pSymbol);
+    if (it == mSymbols.end()) return std::nullopt;
+    return Definition{mNames[it->second.first], it->second.second};
+}
+
+std::optional<std::string> DependencyScope::_locate(const std::string& pName, const Library& pRequester) const {
+    namespace fs = std::filesystem;
+    auto exists  = [](const fs::path& pPath) {
+        std::error_code error;
+        return fs::is_regular_file(pPath, error);
+    };
+
+    if (pName.find('/') != std::string::npos) {
+        auto path = fs::path(pName).is_absolute() ? fs::path(mOptions.mSysroot + pName) : fs::path(pName);
+        if (exists(path)) return path.string();
+        return std::nullopt;
+    }
+
+    for (auto& dir : mOptions.mSearchPaths) {
+        if (exists(fs::path(dir) / pName)) return (fs::path(dir) / pName).string();
+    }
+    constexpr std::string_view ORIGIN = "$ORIGIN";
+    for (auto& runPath : pRequester.mRunPaths) {
+        fs::path dir;
+        if (runPath.starts_with(ORIGIN)) {
+            dir = fs::path(pRequester.mPath).parent_path().string() + runPath.substr(ORIGIN.size());
+        } else {
+            dir = mOptions.mSysroot + runPath;
+        }
+        if (exists(dir / pName)) return (dir / pName).string();
+    }
+    for (auto& dir : mDefaultPaths) {
+        if (exists(fs::path(dir) / pName)) return (fs::path(dir) / pName).string();
+    }
+    return std::nullopt;
+}
+
+std::shared_ptr<const DependencyScope::Library> DependencyScope::_load(const std::string& pPath) {
+    // Shared by every scope of the process, failures included.
+    static std::mutex                                                     cacheMutex;
+    static std::unordered_map<std::string, std::shared_ptr<const Library>> cache;
+
+    std::error_code error;
+    auto            key = std::filesystem::weakly_canonical(pPath, error).string();
+    if (error) key = pPath;
+    {
+        std::lock_guard lock(cacheMutex);
+        if (auto it = cache.find(key); it != cache.end()) return it->second;
+    }
+
+    // Only the dynamic table and .dynsym are needed.
+    LIEF::ELF::ParserConfig config;
+    config.parse_relocations     = false;
+    config.parse_symtab_symbols  = false;
+    config.parse_symbol_versions = false;
+    config.parse_notes           = false;
+    config.parse_overlay         = false;
+
+    std::shared_ptr<Library> library;
+    if (auto binary = LIEF::ELF::Parser::parse(key, config)) {
+        library        = std::make_shared<Library>();
+        library->mPath = key;
+        _readDynamic(*binary, *library);
+        for (auto& symbol : binary->dynamic_symbols()) {
+            if (!symbol.is_exported() || symbol.name().empty()) continue;
+            library->mExports.try_emplace(symbol.name(), symbol.value() - binary->imagebase());
+        }
+    }
+
+    std::lock_guard lock(cacheMutex);
+    return cache.try_emplace(key, std::move(library)).first->second;
+}
+
+void DependencyScope::_readDynamic(const LIEF::ELF::Binary& pBinary, Library& pLibrary) {
+    using TAG = LIEF::ELF::DynamicEntry::TAG;
+    for (auto& entry : pBinary.dynamic_entries()) {
+        switch (entry.tag()) {
+        case TAG::NEEDED:
+            pLibrary.mNeeded.emplace_back(static_cast<const LIEF::ELF::DynamicEntryLibrary&>(entry).name());
+            break;
+        case TAG::RUNPATH:
+            for (auto& path : static_cast<const LIEF::ELF::DynamicEntryRunPath&>(entry).paths()) {
+                pLibrary.mRunPaths.emplace_back(path);
+            }
+            break;
+        case TAG::RPATH:
+            for (auto& path : static_cast<const LIEF::ELF::DynamicEntryRpath&>(entry).paths()) {
+                pLibrary.mRunPaths.emplace_back(path);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+METADUMPER_FORMAT_END
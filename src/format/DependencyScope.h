@@ -0,0 +1,57 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "ELF.h"
+
+METADUMPER_FORMAT_BEGIN
+
+// Global symbol scope of an ELF image and its DT_NEEDED dependencies, used to resolve external vtable slots to the
+// library defining them. As with the dynamic linker, libraries are searched in breadth-first load order and the first
+// definition wins.
+//
+// Every level of dependencies is loaded in parallel. The exported symbols of a library are read once per process and
+// shared by all scopes.
+class DependencyScope {
+public:
+    struct Options {
+        std::string              mSysroot;     // prefix of DT_RUNPATH/DT_RPATH and the default directories.
+        std::vector<std::string> mSearchPaths; // searched first.
+        unsigned int             mThreads{};   // 0 = hardware concurrency.
+    };
+
+    struct Definition {
+        const std::string& mLibrary; // as named by DT_NEEDED.
+        uintptr_t          mRVA;
+    };
+
+    DependencyScope(const std::string& pPath, const ELF& pImage, const Options& pOptions);
+
+    [[nodiscard]] std::optional<Definition> find(std::string_view pSymbol) const;
+
+    [[nodiscard]] size_t getLibraryCount() const { return mLibraries.size(); }
+
+private:
+    struct Library {
+        std::string                                mPath;
+        std::vector<std::string>                   mNeeded;
+        std::vector<std::string>                   mRunPaths; // DT_RUNPATH and DT_RPATH, as stored.
+        std::unordered_map<std::string, uintptr_t> mExports;
+    };
+
+    static std::shared_ptr<const Library> _load(const std::string& pPath);
+    static void                           _readDynamic(const LIEF::ELF::Binary& pBinary, Library& pLibrary);
+
+    std::optional<std::string> _locate(const std::string& pName, const Library& pRequester) const;
+
+    Options                  mOptions;
+    std::vector<std::string> mDefaultPaths; // searched last.
+
+    std::vector<std::string>                    mNames; // as named by DT_NEEDED, in load order.
+    std::vector<std::shared_ptr<const Library>> mLibraries;
+
+    // Keys point into mLibraries.
+    std::unordered_map<std::string_view, std::pair<uint32_t, uintptr_t>> mSymbols; // -> library, RVA
+};
+
+METADUMPER_FORMAT_END
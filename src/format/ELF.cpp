@@ -1,7 +1,11 @@
 #include "ELF.h"
 
+#include <LIEF/BinaryStream/SpanStream.hpp>
 #include <magic_enum.hpp>
 
+#include <cstring>
+#include <span>
+
 // #define DEBUG_DUMP_SECTION
 #ifdef DEBUG_DUMP_SECTION
 #include <fstream>
@@ -9,8 +13,10 @@
 
 METADUMPER_FORMAT_BEGIN
 
-ELF::ELF(const std::string& pPath) : Executable(pPath) {
-    mImage = LIEF::ELF::Parser::parse(pPath);
+ELF::ELF(const std::shared_ptr<MappedFile>& pFile, size_t pMemoryBudget) : Executable(pFile, pMemoryBudget) {
+    if (!isValid()) return;
+    auto bytes = pFile->bytes();
+    mImage     = LIEF::ELF::Parser::parse(std::make_unique<LIEF::SpanStream>(bytes.data(), bytes.size()));
     if (!mImage) {
         spdlog::error("Failed to load elf image.");
         mIsValid = false;
@@ -22,7 +28,14 @@ ELF::ELF(const std::string& pPath) : Executable(pPath) {
         magic_enum::enum_name(mImage->type()),
         magic_enum::enum_name(mImage->header().machine_type())
     );
+    using Header        = LIEF::ELF::Header;
+    auto& header        = mImage->header();
+    mPointerSize        = header.identity_class() == Header::CLASS::ELF32 ? sizeof(uint32_t) : sizeof(uint64_t);
+    mEndianness         = header.identity_data() == Header::ELF_DATA::MSB ? std::endian::big : std::endian::little;
+    mHasImplicitAddends = header.identity_class() == Header::CLASS::ELF32
+                       && (header.machine_type() == Header::ARCH::ARM || header.machine_type() == Header::ARCH::I386);
     _buildSymbolCache();
+    _decodeRelocations();
     _relocateReadonlyData();
 }
 
@@ -50,83 +63,164 @@ size_t ELF::getGapInFront(uintptr_t pVAddr) const {
     throw std::runtime_error("An exception occurred during gap calculation!");
 }
 
-LIEF::ELF::Symbol* ELF::lookupSymbol(uintptr_t pVAddr) {
-    if (mSymbolCache.mFromValue.contains(pVAddr)) return mSymbolCache.mFromValue.at(pVAddr);
-    if (mDynSymbolCache.mFromValue.contains(pVAddr)) return mDynSymbolCache.mFromValue.at(pVAddr);
-    return nullptr;
-}
+LIEF::ELF::Symbol* ELF::lookupSymbol(uintptr_t pVAddr) { return mAddressIndex.lookup(pVAddr); }
 
 LIEF::ELF::Symbol* ELF::lookupSymbol(const std::string& pName) {
-    if (mSymbolCache.mFromName.contains(pName)) return mSymbolCache.mFromName.at(pName);
-    if (mDynSymbolCache.mFromName.contains(pName)) return mDynSymbolCache.mFromName.at(pName);
+    if (auto symbol = mSymbolCache.mFromName.find(pName)) return *symbol;
+    if (auto index = mDynSymbolIndexCache.find(pName)) return mDynSymbols[*index];
     return nullptr;
 }
 
+LIEF::ELF::Symbol* ELF::lookupContainingSymbol(uintptr_t pVAddr, size_t& pOffset) {
+    return mAddressIndex.lookupContaining(pVAddr, pOffset);
+}
+
 size_t ELF::getDynSymbolIndex(const std::string& pName) {
-    return mDynSymbolIndexCache.contains(pName) ? mDynSymbolIndexCache.at(pName) : 0;
+    auto index = mDynSymbolIndexCache.find(pName);
+    return index ? *index : 0;
 }
 
-void ELF::_relocateReadonlyData() {
+LIEF::ELF::Symbol* ELF::getDynSymbol(uint32_t pIndex) const {
+    return pIndex < mDynSymbols.size() ? mDynSymbols[pIndex] : nullptr;
+}
+
+void ELF::_decodeRelocations() {
+    if (!mIsValid) return;
+
+    // The only pass over LIEF's relocations.
+    auto relocations = mImage->dynamic_relocations();
+    mRelocations.reserve(relocations.size());
+    for (auto& relocation : relocations) {
+        mRelocations.emplace_back(Relocation{
+            relocation.address(),
+            relocation.addend(),
+            (uint32_t)relocation.type(),
+            relocation.has_symbol() ? (uint32_t)getDynSymbolIndex(relocation.symbol()->name()) : Relocation::NO_SYMBOL
+        });
+    }
+    dispatchTarget(mPointerSize, mEndianness, [&](auto pTraits) { _decodeRelr<decltype(pTraits)>(); });
+    std::stable_sort(mRelocations.begin(), mRelocations.end(), [](const Relocation& pLhs, const Relocation& pRhs) {
+        return pLhs.mAddress < pRhs.mAddress;
+    });
+}
+
+template <typename Traits>
+void ELF::_decodeRelr() {
     // Reference:
-    // https://github.com/ARM-software/abi-aa/releases/download/2023Q1/aaelf64.pdf
-    // https://refspecs.linuxfoundation.org/elf/elf.pdf
+    // https://groups.google.com/g/generic-abi/c/bX460iggiKg
 
-    if (!mImage->has_section(".data.rel.ro")) return;
+    constexpr uint32_t SHT_RELR  = 19;
+    constexpr uint64_t DT_RELR   = 36;
+    constexpr uint64_t DT_RELRSZ = 35;
 
-    const auto EOS = getEndOfSections();
+    using Word = typename Traits::Pointer;
 
-    for (auto& relocation : mImage->dynamic_relocations()) {
-        auto address = relocation.address();
-        if (!isInSection(address, ".data.rel.ro")) continue;
-        auto offset = address - getGapInFront(address);
-        auto type   = relocation.type();
-        using RELOC = LIEF::ELF::Relocation::TYPE;
-        switch (type) {
-        case RELOC::X86_64_64:
-        case RELOC::AARCH64_ABS64: {
-            auto symbol = relocation.symbol();
-            if (symbol) {
-                if (symbol->value()) {
-                    // Internal Symbol
-                    write<uintptr_t, false>(offset, symbol->value() + relocation.addend());
-                } else {
-                    // External Symbol
-                    // fixme: Deviations may occur, although this does not affect data export.
-                    write<uintptr_t, false>(
-                        offset,
-                        EOS + getDynSymbolIndex(symbol->name()) * sizeof(intptr_t) + relocation.addend()
-                    );
-                }
-            } else {
-                spdlog::error("Get dynamic symbol failed!");
-            }
-            break;
+    std::vector<Word> words;
+    for (auto& section : mImage->sections()) {
+        if ((uint32_t)section.type() != SHT_RELR) continue;
+        auto content = section.content();
+        words.resize(content.size() / sizeof(Word));
+        std::memcpy(words.data(), content.data(), words.size() * sizeof(Word));
+        for (auto& word : words) word = toHost<Traits>(word);
+        break;
+    }
+    if (words.empty()) {
+        // No section headers, fallback to the dynamic table.
+        uintptr_t address{}, size{};
+        for (auto& entry : mImage->dynamic_entries()) {
+            if ((uint64_t)entry.tag() == DT_RELR) address = entry.value();
+            if ((uint64_t)entry.tag() == DT_RELRSZ) size = entry.value();
         }
-        case RELOC::X86_64_RELATIVE:
-        case RELOC::AARCH64_RELATIVE: {
-            if (relocation.has_symbol()) {
-                if (!relocation.addend()) {
-                    spdlog::warn("Unknown type of ADDEND detected.");
+        if (!address || !size) return;
+        words.resize(size / sizeof(Word));
+        move(address, Begin);
+        for (auto& word : words) word = readAs<Traits>();
+    }
+
+    // The implicit addends are already in the file, so there is nothing to write for base 0. Still record them,
+    // to keep the relocation table complete for its users. Addends are read from the section contents directly,
+    // which is much cheaper than going through the stream for millions of entries.
+    struct SectionData {
+        uintptr_t                mBegin;
+        uintptr_t                mEnd;
+        std::span<const uint8_t> mContent;
+    };
+    std::vector<SectionData> sections;
+    for (auto& section : mImage->sections()) {
+        if (!section.virtual_address() || section.content().empty()) continue;
+        sections.emplace_back(
+            SectionData{section.virtual_address(), section.virtual_address() + section.content().size(), section.content()}
+        );
+    }
+    const SectionData* hit{};
+
+    auto emit = [&](uintptr_t pAddress) {
+        if (!hit || pAddress < hit->mBegin || pAddress + sizeof(Word) > hit->mEnd) {
+            hit = nullptr;
+            for (auto& section : sections) {
+                if (pAddress >= section.mBegin && pAddress + sizeof(Word) <= section.mEnd) {
+                    hit = &section;
+                    break;
                 }
-                write<uintptr_t, false>(offset, relocation.addend());
-            } else {
-                // External
-                spdlog::warn("Unhandled type of RELATIVE detected.");
             }
-            break;
         }
-        default:
-            spdlog::warn("Unhandled relocation type: {:#x}.", (uint32_t)type);
-            break;
+        Word addend{};
+        if (hit) std::memcpy(&addend, hit->mContent.data() + (pAddress - hit->mBegin), sizeof(addend));
+        mRelocations.emplace_back(
+            Relocation{pAddress, (int64_t)toHost<Traits>(addend), Relocation::TYPE_RELR, Relocation::NO_SYMBOL}
+        );
+    };
+
+    // An even entry is an address, an odd entry is a bitmap of the following 63 (or 31) words.
+    constexpr size_t WORD_BITS = sizeof(Word) * 8;
+    uintptr_t        where{};
+    for (auto word : words) {
+        if (!(word & 1)) {
+            emit(word);
+            where = word + sizeof(Word);
+            continue;
+        }
+        uintptr_t addr = where;
+        for (auto bitmap = (Word)(word >> 1); bitmap; bitmap >>= 1, addr += sizeof(Word)) {
+            if (bitmap & 1) emit(addr);
         }
+        where += (WORD_BITS - 1) * sizeof(Word);
     }
+}
+
+void ELF::_relocateReadonlyData() {
+    if (!mImage->has_section(".data.rel.ro")) return;
+
+    mEndOfSections = getEndOfSections();
+
+    // There may be more than one section with the same name.
+    for (auto& section : mImage->sections()) {
+        if (section.name() != ".data.rel.ro") continue;
+        mReadonlyData.emplace_back(ReadonlyData{section.offset(), section.virtual_address(), section.size()});
+        // Report problems once here, onLoad() may see the same relocation many times.
+        auto begin = std::lower_bound(
+            mRelocations.begin(),
+            mRelocations.end(),
+            section.virtual_address(),
+            [](const Relocation& pRelocation, uintptr_t pVAddr) { return pRelocation.mAddress < pVAddr; }
+        );
+        for (auto it = begin; it != mRelocations.end() && it->mAddress < section.virtual_address() + section.size();
+             it++) {
+            (void)_resolveRelocation(*it, 0, true);
+        }
+    }
+
+    reload();
+
 #ifdef DEBUG_DUMP_SECTION
     std::ofstream d_Dumper("relro.fixed.dump", std::ios::binary | std::ios::trunc);
     if (d_Dumper.is_open()) {
-        move(begin, Begin);
-        while (cur() < end) {
-            auto data = read<unsigned char>();
-            d_Dumper.write((char*)&data, sizeof(data));
+        for (auto& data : mReadonlyData) {
+            move(data.mAddress, Begin);
+            while (cur() < data.mAddress + data.mSize) {
+                auto byte = read<unsigned char>();
+                d_Dumper.write((char*)&byte, sizeof(byte));
+            }
         }
         d_Dumper.close();
     } else {
@@ -135,32 +229,140 @@ void ELF::_relocateReadonlyData() {
 #endif
 }
 
+void ELF::onLoad(size_t pOffset, std::span<char> pData) {
+    auto isBigEndian = mEndianness == std::endian::big;
+    // Bit position of the idx-th byte of a target word.
+    auto shiftOf = [&](size_t pIdx) { return 8 * (isBigEndian ? mPointerSize - 1 - pIdx : pIdx); };
+
+    for (auto& data : mReadonlyData) {
+        auto begin = std::max(pOffset, data.mOffset);
+        auto end   = std::min(pOffset + pData.size(), data.mOffset + data.mSize);
+        if (begin >= end) continue;
+        // Same distance from the start of the section in file and in memory.
+        auto addressBegin = data.mAddress + (begin - data.mOffset);
+        auto addressEnd   = data.mAddress + (end - data.mOffset);
+        // A relocated word may start before this part.
+        auto it = std::lower_bound(
+            mRelocations.begin(),
+            mRelocations.end(),
+            addressBegin > data.mAddress + mPointerSize ? addressBegin - mPointerSize + 1 : data.mAddress,
+            [](const Relocation& pRelocation, uintptr_t pVAddr) { return pRelocation.mAddress < pVAddr; }
+        );
+        for (; it != mRelocations.end() && it->mAddress < addressEnd; it++) {
+            auto byteAt = [&](size_t pIdx) -> char* {
+                auto address = it->mAddress + pIdx;
+                if (address < addressBegin || address >= addressEnd) return nullptr;
+                return &pData[data.mOffset + (address - data.mAddress) - pOffset];
+            };
+            uintptr_t inPlace{};
+            for (size_t idx = 0; idx < mPointerSize; idx++) {
+                if (auto byte = byteAt(idx)) inPlace |= (uintptr_t)(uint8_t)*byte << shiftOf(idx);
+            }
+            auto value = _resolveRelocation(*it, inPlace, false);
+            if (!value) continue;
+            for (size_t idx = 0; idx < mPointerSize; idx++) {
+                if (auto byte = byteAt(idx)) *byte = (char)(*value >> shiftOf(idx));
+            }
+        }
+    }
+}
+
+std::optional<uintptr_t>
+ELF::_resolveRelocation(const Relocation& pRelocation, uintptr_t pInPlace, bool pVerbose) const {
+    // Reference:
+    // https://github.com/ARM-software/abi-aa/releases/download/2023Q1/aaelf64.pdf
+    // https://refspecs.linuxfoundation.org/elf/elf.pdf
+    // https://github.com/ARM-software/abi-aa/releases/download/2023Q1/aaelf32.pdf
+
+    if (pRelocation.mType == Relocation::TYPE_RELR) return std::nullopt; // implicit addend, already in place.
+    auto  type   = (LIEF::ELF::Relocation::TYPE)pRelocation.mType;
+    auto  addend = mHasImplicitAddends ? (int64_t)pInPlace : pRelocation.mAddend;
+    using RELOC  = LIEF::ELF::Relocation::TYPE;
+    switch (type) {
+    case RELOC::X86_64_64:
+    case RELOC::AARCH64_ABS64:
+    case RELOC::X86_32:
+    case RELOC::ARM_ABS32: {
+        auto symbol = getDynSymbol(pRelocation.mSymbol);
+        if (!symbol) {
+            if (pVerbose) spdlog::error("Get dynamic symbol failed!");
+            return std::nullopt;
+        }
+        if (symbol->value()) {
+            // Internal Symbol
+            return symbol->value() + addend;
+        }
+        // External Symbol
+        // fixme: Deviations may occur, although this does not affect data export.
+        return mEndOfSections + pRelocation.mSymbol * sizeof(intptr_t) + addend;
+    }
+    case RELOC::X86_RELATIVE:
+    case RELOC::ARM_RELATIVE:
+        if (mHasImplicitAddends) return std::nullopt; // REL, already in place.
+        [[fallthrough]];
+    case RELOC::X86_64_RELATIVE:
+    case RELOC::AARCH64_RELATIVE: {
+        if (pRelocation.mSymbol == Relocation::NO_SYMBOL) {
+            // External
+            if (pVerbose) spdlog::warn("Unhandled type of RELATIVE detected.");
+            return std::nullopt;
+        }
+        if (!pRelocation.mAddend && pVerbose) {
+            spdlog::warn("Unknown type of ADDEND detected.");
+        }
+        return pRelocation.mAddend;
+    }
+    default:
+        if (pVerbose) spdlog::warn("Unhandled relocation type: {:#x}.", (uint32_t)type);
+        return std::nullopt;
+    }
+}
+
 void ELF::_buildSymbolCache() {
     if (!mIsValid) return;
 
+    // Names are hashed and inserted in parallel (util::NameMap), the caches are the same as inserting one by one.
+    std::vector<LIEF::ELF::Symbol*> symbols;
     if (mImage->has(LIEF::ELF::Section::TYPE::SYMTAB)) {
-        for (auto& symbol : mImage->symtab_symbols()) {
-            mSymbolCache.mFromName.try_emplace(symbol.name(), &symbol);
-            mSymbolCache.mFromValue.try_emplace(symbol.value(), &symbol);
-        }
+        symbols.reserve(mImage->symtab_symbols().size());
+        for (auto& symbol : mImage->symtab_symbols()) symbols.emplace_back(&symbol);
+        mSymbolCache.mFromName.build(
+            symbols.size(),
+            [&](size_t pIndex) -> const std::string& { return symbols[pIndex]->name(); },
+            [&](size_t pIndex) { return symbols[pIndex]; }
+        );
     } else {
         spdlog::warn(".symtab not found in this image!");
     }
 
+    // First index of every name, the fake address of an undefined symbol.
+    std::vector<size_t> firstIndex;
     if (mImage->has(LIEF::ELF::Section::TYPE::DYNSYM)) {
-        auto idx = 0;
-        for (auto& symbol : mImage->dynamic_symbols()) {
-            mDynSymbolIndexCache.try_emplace(symbol.name(), idx);
-            mDynSymbolCache.mFromName.try_emplace(symbol.name(), &symbol);
-            mDynSymbolCache.mFromValue.try_emplace(
-                getEndOfSections() + sizeof(intptr_t) * getDynSymbolIndex(symbol.name()),
-                &symbol
-            );
-            idx++;
-        }
+        mDynSymbols.reserve(mImage->dynamic_symbols().size());
+        for (auto& symbol : mImage->dynamic_symbols()) mDynSymbols.emplace_back(&symbol);
+        auto name = [&](size_t pIndex) -> const std::string& { return mDynSymbols[pIndex]->name(); };
+        mDynSymbolIndexCache.build(mDynSymbols.size(), name, [](size_t pIndex) { return pIndex; });
+        firstIndex.resize(mDynSymbols.size());
+        util::parallelForChunks(mDynSymbols.size(), [&](size_t, size_t pBegin, size_t pEnd) {
+            for (auto idx = pBegin; idx < pEnd; idx++) firstIndex[idx] = getDynSymbolIndex(name(idx));
+        });
     } else {
         spdlog::warn(".dynsym not found in this image!");
     }
+
+    // In the serial order, so that duplicate addresses resolve to the same symbols.
+    mAddressIndex.reserve(symbols.size() + 2 * mDynSymbols.size());
+    for (auto symbol : symbols) mAddressIndex.add(symbol->value(), symbol->size(), symbol);
+    const auto EOS = getEndOfSections();
+    for (size_t idx = 0; idx < mDynSymbols.size(); idx++) {
+        auto symbol = mDynSymbols[idx];
+        if (symbol->value()) {
+            // Defined, lets stripped images still resolve exported functions.
+            mAddressIndex.add(symbol->value(), symbol->size(), symbol);
+        }
+        mAddressIndex.add(EOS + sizeof(intptr_t) * firstIndex[idx], sizeof(intptr_t), symbol);
+    }
+    mAddressIndex.build();
 }
 
 METADUMPER_FORMAT_END
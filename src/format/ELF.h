@@ -3,43 +3,90 @@
 #include "base/Base.h"
 #include "base/Executable.h"
 
+#include "util/AddressIndex.h"
+#include "util/NameMap.h"
+
 // Don't use LIEF low performance method:
 // * get_symbol() -> use ELF::lookupSymbol() instead
 // * dynsym_idx() -> use ELF::getDynSymbolIndex() instead
 
 #include <LIEF/ELF.hpp>
 
+#include <optional>
+
 METADUMPER_FORMAT_BEGIN
 
 class ELF : public Executable {
 public:
-    explicit ELF(const std::string& pPath);
+    // Decoded once from .rela.dyn and .relr.dyn, shared by the .data.rel.ro rebuild and the reader.
+    struct Relocation {
+        uintptr_t mAddress;
+        int64_t   mAddend;
+        uint32_t  mType;   // LIEF::ELF::Relocation::TYPE, or TYPE_RELR.
+        uint32_t  mSymbol; // index of .dynsym, or NO_SYMBOL.
+
+        static constexpr uint32_t NO_SYMBOL = UINT32_MAX;
+        // Packed relative relocation, the addend is implicit (already stored at mAddress).
+        static constexpr uint32_t TYPE_RELR = UINT32_MAX;
+    };
+
+    // LIEF parses pFile in place, before the Loader relocates anything in it.
+    explicit ELF(const std::shared_ptr<MappedFile>& pFile, size_t pMemoryBudget = 0);
 
     [[nodiscard]] uintptr_t getEndOfSections() const override;
     [[nodiscard]] size_t    getGapInFront(uintptr_t pVAddr) const override;
 
     LIEF::ELF::Symbol* lookupSymbol(uintptr_t pVAddr) override;
     LIEF::ELF::Symbol* lookupSymbol(const std::string& pName) override;
+    LIEF::ELF::Symbol* lookupContainingSymbol(uintptr_t pVAddr, size_t& pOffset) override;
+
+    size_t             getDynSymbolIndex(const std::string& pName);
+    LIEF::ELF::Symbol* getDynSymbol(uint32_t pIndex) const;
 
-    size_t getDynSymbolIndex(const std::string& pName);
+    // Sorted by address.
+    [[nodiscard]] const std::vector<Relocation>& getRelocations() const { return mRelocations; }
 
     LIEF::ELF::Binary* getImage() const override { return mImage.get(); }
 
+protected:
+    void onLoad(size_t pOffset, std::span<char> pData) override;
+
 private:
+    // .data.rel.ro is relocated as it is loaded, see onLoad().
+    struct ReadonlyData {
+        size_t    mOffset;
+        uintptr_t mAddress;
+        size_t    mSize;
+    };
+
+    void _decodeRelocations();
+    template <typename Traits>
+    void _decodeRelr();
     void _relocateReadonlyData();
     void _buildSymbolCache();
 
+    // pInPlace is the word at the relocated address, the addend of REL relocations.
+    std::optional<uintptr_t> _resolveRelocation(const Relocation& pRelocation, uintptr_t pInPlace, bool pVerbose) const;
+
     struct SymbolCache {
-        std::unordered_map<uintptr_t, LIEF::ELF::Symbol*>   mFromValue;
-        std::unordered_map<std::string, LIEF::ELF::Symbol*> mFromName;
+        util::NameMap<LIEF::ELF::Symbol*> mFromName;
     };
 
     std::unique_ptr<LIEF::ELF::Binary> mImage;
 
     SymbolCache mSymbolCache;
-    SymbolCache mDynSymbolCache;
 
-    std::unordered_map<std::string, size_t> mDynSymbolIndexCache;
+    // .symtab, then .dynsym (defined and fake addresses of undefined).
+    util::AddressIndex<LIEF::ELF::Symbol> mAddressIndex;
+
+    // Also the name lookup of .dynsym, through mDynSymbols.
+    util::NameMap<size_t>           mDynSymbolIndexCache;
+    std::vector<LIEF::ELF::Symbol*> mDynSymbols;
+
+    std::vector<Relocation>   mRelocations;
+    std::vector<ReadonlyData> mReadonlyData;
+    uintptr_t                 mEndOfSections{};
+    bool                      mHasImplicitAddends{}; // REL instead of RELA, i386 and ARM32.
 };
 
 METADUMPER_FORMAT_END
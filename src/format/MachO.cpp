@@ -1,5 +1,9 @@
 #include "MachO.h"
 
+#include <LIEF/BinaryStream/SpanStream.hpp>
+
+#include <cstring>
+
 // magic_enum is out-of-range.
 
 using MACHO_TYPES = LIEF::MachO::MACHO_TYPES;
@@ -52,8 +56,122 @@ std::string macho_cpu_to_str(CPU_TYPE cpu) {
 
 METADUMPER_FORMAT_BEGIN
 
-MachO::MachO(const std::string& pPath) : Executable(pPath) {
-    auto fatBinary = LIEF::MachO::Parser::parse(pPath);
+namespace {
+
+// Reference: <mach-o/fixup-chains.h>, only the formats of user space images.
+enum ChainedPointerFormat : uint16_t {
+    DYLD_CHAINED_PTR_ARM64E            = 1,
+    DYLD_CHAINED_PTR_64                = 2,
+    DYLD_CHAINED_PTR_32                = 3,
+    DYLD_CHAINED_PTR_64_OFFSET         = 6,
+    DYLD_CHAINED_PTR_ARM64E_USERLAND   = 9,
+    DYLD_CHAINED_PTR_ARM64E_USERLAND24 = 12,
+};
+
+enum ChainedImportFormat : uint32_t {
+    DYLD_CHAINED_IMPORT          = 1,
+    DYLD_CHAINED_IMPORT_ADDEND   = 2,
+    DYLD_CHAINED_IMPORT_ADDEND64 = 3,
+};
+
+constexpr uint16_t DYLD_CHAINED_PTR_START_NONE  = 0xFFFF;
+constexpr uint16_t DYLD_CHAINED_PTR_START_MULTI = 0x8000; // 32-bit only, page_start[] index of a list of starts.
+constexpr uint16_t DYLD_CHAINED_PTR_START_LAST  = 0x8000; // ends that list.
+
+// A pointer of a chain, once its format is known.
+struct ChainedPointer {
+    uint64_t mNext;     // in strides, 0 ends the chain.
+    bool     mIsBind;
+    uint32_t mOrdinal;  // of the import, for a bind.
+    int64_t  mAddend;   // for a bind.
+    uint64_t mTarget;   // for a rebase, high byte included.
+    bool     mIsOffset; // mTarget is relative to the image base.
+};
+
+uint64_t bits(uint64_t pValue, unsigned int pShift, unsigned int pWidth) {
+    return (pValue >> pShift) & ((1ull << pWidth) - 1);
+}
+
+// Chained fixups only exist for little-endian targets.
+template <typename T>
+T load(std::span<const uint8_t> pData, size_t pOffset) {
+    if (pOffset > pData.size() || pData.size() - pOffset < sizeof(T)) {
+        throw std::runtime_error("Chained fixups are truncated.");
+    }
+    T value;
+    std::memcpy(&value, pData.data() + pOffset, sizeof(T));
+    return toHost<Target64LE>(value);
+}
+
+size_t stride_of(uint16_t pFormat) {
+    switch (pFormat) {
+    case DYLD_CHAINED_PTR_ARM64E:
+    case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+    case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+        return 8;
+    case DYLD_CHAINED_PTR_64:
+    case DYLD_CHAINED_PTR_64_OFFSET:
+    case DYLD_CHAINED_PTR_32:
+        return 4;
+    default:
+        return 0; // unsupported
+    }
+}
+
+ChainedPointer decode_pointer(uint16_t pFormat, uint64_t pRaw, uint32_t pMaxValidPointer) {
+    ChainedPointer ret{};
+    switch (pFormat) {
+    case DYLD_CHAINED_PTR_64:
+    case DYLD_CHAINED_PTR_64_OFFSET:
+        ret.mNext   = bits(pRaw, 51, 12);
+        ret.mIsBind = bits(pRaw, 63, 1);
+        if (ret.mIsBind) {
+            ret.mOrdinal = (uint32_t)bits(pRaw, 0, 24);
+            ret.mAddend  = (int64_t)bits(pRaw, 24, 8);
+        } else {
+            ret.mTarget   = bits(pRaw, 0, 36) | bits(pRaw, 36, 8) << 56;
+            ret.mIsOffset = pFormat == DYLD_CHAINED_PTR_64_OFFSET;
+        }
+        break;
+    case DYLD_CHAINED_PTR_32:
+        ret.mNext   = bits(pRaw, 26, 5);
+        ret.mIsBind = bits(pRaw, 31, 1);
+        if (ret.mIsBind) {
+            ret.mOrdinal = (uint32_t)bits(pRaw, 0, 20);
+            ret.mAddend  = (int64_t)bits(pRaw, 20, 6);
+        } else {
+            ret.mTarget = bits(pRaw, 0, 26);
+            // Not a pointer, but a value that happens to be in the chain.
+            if (ret.mTarget > pMaxValidPointer) ret.mTarget -= (0x04000000 + pMaxValidPointer) / 2;
+        }
+        break;
+    default: { // arm64e
+        auto isAuth = bits(pRaw, 63, 1);
+        ret.mNext   = bits(pRaw, 51, 11);
+        ret.mIsBind = bits(pRaw, 62, 1);
+        if (ret.mIsBind) {
+            ret.mOrdinal = (uint32_t)bits(pRaw, 0, pFormat == DYLD_CHAINED_PTR_ARM64E_USERLAND24 ? 24 : 16);
+            // 19-bit signed.
+            if (!isAuth) ret.mAddend = (int64_t)(bits(pRaw, 32, 19) << 45) >> 45;
+        } else if (isAuth) {
+            ret.mTarget   = bits(pRaw, 0, 32);
+            ret.mIsOffset = true;
+        } else {
+            ret.mTarget   = bits(pRaw, 0, 43) | bits(pRaw, 43, 8) << 56;
+            ret.mIsOffset = pFormat != DYLD_CHAINED_PTR_ARM64E;
+        }
+        break;
+    }
+    }
+    return ret;
+}
+
+} // namespace
+
+MachO::MachO(const std::shared_ptr<MappedFile>& pFile, size_t pMemoryBudget) : Executable(pFile, pMemoryBudget) {
+    if (!isValid()) return;
+    auto bytes     = pFile->bytes();
+    auto fatBinary = LIEF::MachO::Parser::parse(std::make_unique<LIEF::SpanStream>(bytes.data(), bytes.size()));
     if (!fatBinary) {
         spdlog::error("Failed to load mach-o image.");
         mIsValid = false;
@@ -66,12 +184,30 @@ MachO::MachO(const std::string& pPath) : Executable(pPath) {
     }
     mImage     = fatBinary->take(0);
     auto magic = mImage->header().magic();
-    if (magic != MACHO_TYPES::MH_MAGIC_64) {
+    switch (magic) {
+    case MACHO_TYPES::MH_MAGIC:
+    case MACHO_TYPES::MH_CIGAM:
+        mPointerSize = sizeof(uint32_t);
+        break;
+    case MACHO_TYPES::MH_MAGIC_64:
+    case MACHO_TYPES::MH_CIGAM_64:
+        mPointerSize = sizeof(uint64_t);
+        break;
+    default:
         spdlog::error("{} are not supported yet.", macho_type_to_str(magic));
+        mIsValid = false;
         return;
     }
+    if (magic == MACHO_TYPES::MH_CIGAM || magic == MACHO_TYPES::MH_CIGAM_64) mEndianness = std::endian::big;
     spdlog::info("{:<12}{} for {}", "Format:", macho_type_to_str(magic), macho_cpu_to_str(mImage->header().cpu_type()));
     _buildSymbolCache();
+    try {
+        _decodeChainedFixups(pFile->bytes());
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        mChainedFixups.clear();
+    }
+    if (!mChainedFixups.empty()) reload();
 }
 
 uintptr_t MachO::getEndOfSections() const {
@@ -97,14 +233,158 @@ size_t MachO::getGapInFront(uintptr_t pVAddr) const {
     throw std::runtime_error("An exception occurred during gap calculation!");
 }
 
-LIEF::MachO::Symbol* MachO::lookupSymbol(uintptr_t pVAddr) {
-    if (mSymbolCache.mFromValue.contains(pVAddr)) return mSymbolCache.mFromValue.at(pVAddr);
-    return nullptr;
-}
+LIEF::MachO::Symbol* MachO::lookupSymbol(uintptr_t pVAddr) { return mAddressIndex.lookup(pVAddr); }
 
 LIEF::MachO::Symbol* MachO::lookupSymbol(const std::string& pName) {
-    if (mSymbolCache.mFromName.contains(pName)) return mSymbolCache.mFromName.at(pName);
-    return nullptr;
+    auto symbol = mSymbolCache.mFromName.find(pName);
+    return symbol ? *symbol : nullptr;
+}
+
+LIEF::MachO::Symbol* MachO::lookupContainingSymbol(uintptr_t pVAddr, size_t& pOffset) {
+    return mAddressIndex.lookupContaining(pVAddr, pOffset);
+}
+
+void MachO::onLoad(size_t pOffset, std::span<char> pData) {
+    // Every chain pointer is replaced by what it points to, the chains can't be walked again afterwards.
+    auto end = pOffset + pData.size();
+    // A fixed up word may start before this part.
+    auto it = std::lower_bound(
+        mChainedFixups.begin(),
+        mChainedFixups.end(),
+        pOffset > mPointerSize ? pOffset - mPointerSize + 1 : 0,
+        [](const ChainedFixup& pFixup, size_t pOffset) { return pFixup.mOffset < pOffset; }
+    );
+    for (; it != mChainedFixups.end() && it->mOffset < end; it++) {
+        for (size_t idx = 0; idx < mPointerSize; idx++) {
+            auto offset = it->mOffset + idx;
+            if (offset >= pOffset && offset < end) pData[offset - pOffset] = (char)(it->mValue >> (8 * idx));
+        }
+    }
+}
+
+void MachO::_decodeChainedFixups(std::span<const uint8_t> pFile) {
+    auto command = mImage->dyld_chained_fixups();
+    if (!command) return;
+    if (command->data_offset() > pFile.size() || pFile.size() - command->data_offset() < command->data_size()) {
+        throw std::runtime_error("LC_DYLD_CHAINED_FIXUPS is out of the file.");
+    }
+    auto data = pFile.subspan(command->data_offset(), command->data_size());
+
+    // dyld_chained_fixups_header
+    auto startsOffset  = load<uint32_t>(data, 4);
+    auto importsOffset = load<uint32_t>(data, 8);
+    auto symbolsOffset = load<uint32_t>(data, 12);
+    auto importsCount  = load<uint32_t>(data, 16);
+    auto importsFormat = load<uint32_t>(data, 20);
+    auto symbolsFormat = load<uint32_t>(data, 24);
+    if (symbolsFormat != 0) {
+        spdlog::warn("Compressed chained fixups symbols are not supported.");
+        return;
+    }
+
+    std::vector<int64_t> addends(importsCount);
+    mChainedImports.reserve(importsCount);
+    for (uint32_t idx = 0; idx < importsCount; idx++) {
+        uint64_t nameOffset{};
+        switch (importsFormat) {
+        case DYLD_CHAINED_IMPORT:
+            nameOffset = bits(load<uint32_t>(data, importsOffset + 4 * idx), 9, 23);
+            break;
+        case DYLD_CHAINED_IMPORT_ADDEND:
+            nameOffset   = bits(load<uint32_t>(data, importsOffset + 8 * idx), 9, 23);
+            addends[idx] = load<int32_t>(data, importsOffset + 8 * idx + 4);
+            break;
+        case DYLD_CHAINED_IMPORT_ADDEND64:
+            nameOffset   = bits(load<uint64_t>(data, importsOffset + 16 * idx), 32, 32);
+            addends[idx] = load<int64_t>(data, importsOffset + 16 * idx + 8);
+            break;
+        default:
+            throw std::runtime_error(fmt::format("Unknown chained imports format {}.", importsFormat));
+        }
+        auto name = symbolsOffset + nameOffset;
+        if (name >= data.size()) throw std::runtime_error("Chained fixups are truncated.");
+        auto chars = (const char*)data.data() + name;
+        mChainedImports.emplace_back(chars, strnlen(chars, data.size() - name));
+    }
+
+    // Every page is walked once, along its chains.
+    auto imageBase    = (uint64_t)getImageBase();
+    auto segmentCount = load<uint32_t>(data, startsOffset);
+    for (uint32_t segment = 0; segment < segmentCount; segment++) {
+        auto infoOffset = load<uint32_t>(data, startsOffset + 4 + 4 * segment);
+        if (!infoOffset) continue; // no fixups.
+
+        // dyld_chained_starts_in_segment
+        auto info          = startsOffset + infoOffset;
+        auto pageSize      = load<uint16_t>(data, info + 4);
+        auto format        = load<uint16_t>(data, info + 6);
+        auto segmentOffset = load<uint64_t>(data, info + 8);
+        auto maxValid      = load<uint32_t>(data, info + 16);
+        auto pageCount     = load<uint16_t>(data, info + 20);
+        auto pageStarts    = info + 22;
+        auto stride        = stride_of(format);
+        if (!stride) {
+            spdlog::warn("Chained pointer format {} is not supported.", format);
+            continue;
+        }
+
+        auto walk = [&](uintptr_t pPage, uint16_t pStart) {
+            auto address = pPage + pStart;
+            auto offset  = _getFileOffset(address);
+            if (!offset) throw std::runtime_error(fmt::format("Fixup chain at {:#x} is not in the file.", address));
+            for (auto inPage = (size_t)pStart; inPage < pageSize;) {
+                auto raw = format == DYLD_CHAINED_PTR_32 ? load<uint32_t>(pFile, *offset)
+                                                         : load<uint64_t>(pFile, *offset);
+                auto ptr = decode_pointer(format, raw, maxValid);
+                if (ptr.mIsBind) {
+                    if (ptr.mOrdinal >= mChainedImports.size()) {
+                        throw std::runtime_error(fmt::format("Bad import ordinal at {:#x}.", address));
+                    }
+                    auto value = (uint64_t)(addends[ptr.mOrdinal] + ptr.mAddend);
+                    mChainedFixups.emplace_back(ChainedFixup{address, *offset, value, ptr.mOrdinal});
+                } else {
+                    auto value = ptr.mTarget + (ptr.mIsOffset ? imageBase : 0);
+                    mChainedFixups.emplace_back(ChainedFixup{address, *offset, value, ChainedFixup::NO_IMPORT});
+                }
+                if (!ptr.mNext) break;
+                address += ptr.mNext * stride;
+                *offset += ptr.mNext * stride;
+                inPage  += ptr.mNext * stride;
+            }
+        };
+
+        for (uint16_t page = 0; page < pageCount; page++) {
+            auto pageAddress = imageBase + segmentOffset + (uint64_t)page * pageSize;
+            auto start       = load<uint16_t>(data, pageStarts + 2 * page);
+            if (start == DYLD_CHAINED_PTR_START_NONE) continue;
+            if (format != DYLD_CHAINED_PTR_32 || !(start & DYLD_CHAINED_PTR_START_MULTI)) {
+                walk(pageAddress, start);
+                continue;
+            }
+            for (auto idx = (size_t)(start & ~DYLD_CHAINED_PTR_START_MULTI);; idx++) {
+                auto multi = load<uint16_t>(data, pageStarts + 2 * idx);
+                walk(pageAddress, multi & ~DYLD_CHAINED_PTR_START_LAST);
+                if (multi & DYLD_CHAINED_PTR_START_LAST) break;
+            }
+        }
+    }
+
+    // Segments are in file order, this is almost always a no-op.
+    auto byOffset = [](const ChainedFixup& pLeft, const ChainedFixup& pRight) {
+        return pLeft.mOffset < pRight.mOffset;
+    };
+    if (!std::is_sorted(mChainedFixups.begin(), mChainedFixups.end(), byOffset)) {
+        std::sort(mChainedFixups.begin(), mChainedFixups.end(), byOffset);
+    }
+    spdlog::info("{:<12}{} fixup(s), {} import(s)", "Chains:", mChainedFixups.size(), mChainedImports.size());
+}
+
+std::optional<size_t> MachO::_getFileOffset(uintptr_t pVAddr) const {
+    for (auto& segment : mImage->segments()) {
+        auto begin = segment.virtual_address();
+        if (pVAddr >= begin && pVAddr < begin + segment.file_size()) return segment.file_offset() + (pVAddr - begin);
+    }
+    return std::nullopt;
 }
 
 void MachO::_buildSymbolCache() {
@@ -114,10 +394,19 @@ void MachO::_buildSymbolCache() {
         spdlog::warn("__symtab not found in this image!");
     }
 
-    for (auto& symbol : mImage->symbols()) {
-        mSymbolCache.mFromName.try_emplace(symbol.name(), &symbol);
-        mSymbolCache.mFromValue.try_emplace(symbol.value(), &symbol);
-    }
+    std::vector<LIEF::MachO::Symbol*> symbols;
+    symbols.reserve(mImage->symbols().size());
+    for (auto& symbol : mImage->symbols()) symbols.emplace_back(&symbol);
+    // Hashed and inserted in parallel, the same cache as inserting one by one.
+    mSymbolCache.mFromName.build(
+        symbols.size(),
+        [&](size_t pIndex) -> const std::string& { return symbols[pIndex]->name(); },
+        [&](size_t pIndex) { return symbols[pIndex]; }
+    );
+
+    mAddressIndex.reserve(symbols.size());
+    for (auto symbol : symbols) mAddressIndex.add(symbol->value(), 0, symbol);
+    mAddressIndex.build(true); // nlist has no size.
 }
 
 METADUMPER_FORMAT_END
@@ -3,13 +3,28 @@
 #include "base/Base.h"
 #include "base/Executable.h"
 
+#include "util/AddressIndex.h"
+#include "util/NameMap.h"
+
 #include <LIEF/MachO.hpp>
 
+#include <optional>
+
 METADUMPER_FORMAT_BEGIN
 
 class MachO : public Executable {
 public:
-    explicit MachO(const std::string& pPath);
+    // Decoded once from the pointer chains of LC_DYLD_CHAINED_FIXUPS, shared by the data overlay and the reader.
+    struct ChainedFixup {
+        uintptr_t mAddress;
+        size_t    mOffset; // in the file.
+        uint64_t  mValue;  // rebased pointer, or addend of a bind.
+        uint32_t  mImport; // index of getChainedImports(), or NO_IMPORT for rebases.
+
+        static constexpr uint32_t NO_IMPORT = UINT32_MAX;
+    };
+
+    explicit MachO(const std::shared_ptr<MappedFile>& pFile, size_t pMemoryBudget = 0);
 
     [[nodiscard]] uintptr_t getEndOfSections() const override;
     [[nodiscard]] size_t    getGapInFront(uintptr_t pVAddr) const override;
@@ -17,20 +32,35 @@ public:
     // lief's get_symbol is very slow!
     LIEF::MachO::Symbol* lookupSymbol(uintptr_t pVAddr) override;
     LIEF::MachO::Symbol* lookupSymbol(const std::string& pName) override;
+    LIEF::MachO::Symbol* lookupContainingSymbol(uintptr_t pVAddr, size_t& pOffset) override;
+
+    // Sorted by file offset, empty without LC_DYLD_CHAINED_FIXUPS.
+    [[nodiscard]] const std::vector<ChainedFixup>& getChainedFixups() const { return mChainedFixups; }
+    [[nodiscard]] const std::vector<std::string>&  getChainedImports() const { return mChainedImports; }
 
     LIEF::MachO::Binary* getImage() const override { return mImage.get(); }
 
+protected:
+    void onLoad(size_t pOffset, std::span<char> pData) override;
+
 private:
     void _buildSymbolCache();
+    void _decodeChainedFixups(std::span<const uint8_t> pFile);
+    // For the chains, which are only in mapped segments.
+    std::optional<size_t> _getFileOffset(uintptr_t pVAddr) const;
 
     struct SymbolCache {
-        std::unordered_map<uintptr_t, LIEF::MachO::Symbol*>   mFromValue;
-        std::unordered_map<std::string, LIEF::MachO::Symbol*> mFromName;
+        util::NameMap<LIEF::MachO::Symbol*> mFromName;
     };
 
     std::unique_ptr<LIEF::MachO::Binary> mImage;
 
     SymbolCache mSymbolCache;
+
+    util::AddressIndex<LIEF::MachO::Symbol> mAddressIndex;
+
+    std::vector<ChainedFixup> mChainedFixups;
+    std::vector<std::string>  mChainedImports;
 };
 
 METADUMPER_FORMAT_END
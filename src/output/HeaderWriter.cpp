@@ -0,0 +1,220 @@
+#include "HeaderWriter.h"
+#include "OutputFile.h"
+
+#include <algorithm>
+
+METADUMPER_OUTPUT_BEGIN
+
+namespace {
+
+// Everything but the data, kept in sync with HeaderWriter::hashName().
+constexpr std::string_view PROLOGUE = R"(#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace {} {{
+
+struct Slot {{
+    uint64_t         mRVA;     // 0 for unknown external functions.
+    std::string_view mSymbol;  // empty if unknown.
+    std::string_view mLibrary; // defining library of an external slot, mRVA is then relative to it.
+}};
+
+struct SubTable {{
+    std::ptrdiff_t mOffset;
+    uint32_t       mSlotBegin; // [mSlotBegin, mSlotBegin + mSlotCount) of SLOTS.
+    uint32_t       mSlotCount;
+}};
+
+struct VTable {{
+    std::string_view mName;     // _ZTV...
+    std::string_view mTypeName; // _ZTI..., empty if unknown.
+    uint32_t         mSubTableBegin; // [mSubTableBegin, mSubTableBegin + mSubTableCount) of SUB_TABLES.
+    uint32_t         mSubTableCount;
+}};
+
+inline constexpr uint64_t hashName(std::string_view pName, uint64_t pSeed) {{
+    uint64_t value = 0xcbf29ce484222325ull ^ pSeed;
+    for (char c : pName) {{
+        value ^= (uint8_t)c;
+        value *= 0x100000001b3ull;
+    }}
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    return value;
+}}
+
+)";
+
+constexpr std::string_view EPILOGUE = R"(
+// The vtable named pName, or nullptr.
+inline constexpr const VTable* findVTable(std::string_view pName) {
+    if (VTABLE_COUNT == 0) return nullptr;
+    constexpr uint64_t count        = sizeof(VTABLES) / sizeof(VTABLES[0]);
+    auto               displacement = DISPLACEMENTS[hashName(pName, 0) % count];
+    auto index = displacement < 0 ? (uint64_t)(-displacement - 1) : hashName(pName, (uint64_t)displacement) % count;
+    return VTABLES[index].mName == pName ? &VTABLES[index] : nullptr;
+}
+
+)";
+
+// As a C++ string literal. Octal escapes, which unlike \x can't swallow the next character.
+std::string quote(std::string_view pText) {
+    std::string ret = "\"";
+    for (unsigned char c : pText) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+            ret += (char)c;
+        } else if (c < 0x20 || c >= 0x7f || c == '?') { // '?' for trigraphs.
+            ret += fmt::format("\\{:03o}", c);
+        } else {
+            ret += (char)c;
+        }
+    }
+    return ret + '"';
+}
+
+// Bucket searches give up past this, which in practice means duplicate names.
+constexpr int32_t MAX_DISPLACEMENT = 1 << 24;
+
+} // namespace
+
+HeaderWriter::HeaderWriter(std::string pPath, std::string pNamespace)
+: mPath(std::move(pPath)),
+  mNamespace(std::move(pNamespace)) {}
+
+void HeaderWriter::add(const abi::itanium::VTable& pTable) {
+    mEntries.emplace_back(Entry{pTable.mName, pTable.mTypeName, (uint32_t)mSubTables.size(), 0});
+    for (auto& [offset, columns] : pTable.mSubTables) {
+        mSubTables.emplace_back(SubTable{offset, (uint32_t)mSlots.size(), (uint32_t)columns.size()});
+        mSlots.insert(mSlots.end(), columns.begin(), columns.end());
+    }
+    mEntries.back().mSubTableCount = (uint32_t)(mSubTables.size() - mEntries.back().mSubTableBegin);
+}
+
+uint64_t HeaderWriter::hashName(std::string_view pName, uint64_t pSeed) {
+    uint64_t value = 0xcbf29ce484222325ull ^ pSeed;
+    for (char c : pName) {
+        value ^= (uint8_t)c;
+        value *= 0x100000001b3ull;
+    }
+    // Final mix of murmur3, FNV alone leaves the low bits (the modulo) poorly distributed.
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    return value;
+}
+
+std::pair<std::vector<int32_t>, std::vector<uint32_t>> HeaderWriter::_buildHash() const {
+    auto count = (uint64_t)mEntries.size();
+
+    std::vector<std::vector<uint32_t>> buckets(count);
+    for (uint32_t idx = 0; idx < count; idx++) buckets[hashName(mEntries[idx].mName, 0) % count].emplace_back(idx);
+    std::vector<uint32_t> order(count);
+    for (uint32_t idx = 0; idx < count; idx++) order[idx] = idx;
+    // Largest buckets first, while most slots are still free.
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t pLeft, uint32_t pRight) {
+        return buckets[pLeft].size() > buckets[pRight].size();
+    });
+
+    std::vector<int32_t>  displacements(count);
+    std::vector<uint32_t> slots(count, UINT32_MAX);
+    std::vector<uint64_t> candidates;
+
+    size_t next = 0;
+    for (auto bucket : order) {
+        auto& keys = buckets[bucket];
+        if (keys.empty()) break;
+        if (keys.size() == 1) {
+            // No hash needed, the first free slot.
+            while (slots[next] != UINT32_MAX) next++;
+            slots[next]           = keys[0];
+            displacements[bucket] = -(int32_t)next - 1;
+            continue;
+        }
+        for (int32_t displacement = 1;; displacement++) {
+            if (displacement == MAX_DISPLACEMENT) {
+                auto& name = mEntries[keys[0]].mName;
+                throw std::runtime_error(fmt::format("No perfect hash for {}, duplicate names?", name));
+            }
+            candidates.clear();
+            for (auto key : keys) {
+                auto slot = hashName(mEntries[key].mName, (uint64_t)displacement) % count;
+                if (slots[slot] != UINT32_MAX
+                    || std::find(candidates.begin(), candidates.end(), slot) != candidates.end()) {
+                    break;
+                }
+                candidates.emplace_back(slot);
+            }
+            if (candidates.size() != keys.size()) continue;
+            for (size_t idx = 0; idx < keys.size(); idx++) slots[candidates[idx]] = keys[idx];
+            displacements[bucket] = displacement;
+            break;
+        }
+    }
+    return {std::move(displacements), std::move(slots)};
+}
+
+bool HeaderWriter::finish() {
+    // The last of duplicate names wins, as in the JSON output.
+    {
+        std::unordered_map<std::string_view, size_t> last;
+        for (size_t idx = 0; idx < mEntries.size(); idx++) last.insert_or_assign(mEntries[idx].mName, idx);
+        if (last.size() != mEntries.size()) {
+            std::vector<Entry> entries;
+            for (size_t idx = 0; idx < mEntries.size(); idx++) {
+                if (last.at(mEntries[idx].mName) == idx) entries.emplace_back(std::move(mEntries[idx]));
+            }
+            mEntries = std::move(entries);
+        }
+    }
+
+    std::vector<int32_t>  displacements;
+    std::vector<uint32_t> slots;
+    try {
+        std::tie(displacements, slots) = _buildHash();
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        return false;
+    }
+
+    OutputFile file(mPath, Compression::None);
+    if (!file.isValid()) return false;
+    auto& stream = file.stream();
+
+    stream << "// Generated by cppmetadumper, do not edit. " << mEntries.size() << " vtable(s).\n\n";
+    stream << fmt::format(PROLOGUE, mNamespace);
+
+    stream << "inline constexpr Slot SLOTS[] = {\n";
+    if (mSlots.empty()) stream << "    {0, \"\", \"\"},\n"; // no empty arrays.
+    for (auto& slot : mSlots) {
+        stream << "    {" << fmt::format("{:#x}", slot.mRVA) << ", " << quote(slot.mSymbolName.value_or("")) << ", "
+               << quote(slot.mLibrary.value_or("")) << "},\n";
+    }
+    stream << "};\n\ninline constexpr SubTable SUB_TABLES[] = {\n";
+    if (mSubTables.empty()) stream << "    {0, 0, 0},\n";
+    for (auto& subTable : mSubTables) {
+        stream << "    {" << subTable.mOffset << ", " << subTable.mSlotBegin << ", " << subTable.mSlotCount << "},\n";
+    }
+    stream << "};\n\ninline constexpr uint64_t VTABLE_COUNT = " << mEntries.size() << ";\n\n";
+    stream << "// In hash order.\ninline constexpr VTable VTABLES[] = {\n";
+    if (slots.empty()) stream << "    {\"\", \"\", 0, 0},\n";
+    for (auto entry : slots) {
+        auto& table = mEntries[entry];
+        stream << "    {" << quote(table.mName) << ", " << quote(table.mTypeName.value_or("")) << ", "
+               << table.mSubTableBegin << ", " << table.mSubTableCount << "},\n";
+    }
+    stream << "};\n\n// Per bucket: n > 0 rehashes with seed n, n < 0 is the index -n - 1.\n";
+    stream << "inline constexpr int32_t DISPLACEMENTS[] = {";
+    if (displacements.empty()) stream << "\n    -1,";
+    for (size_t idx = 0; idx < displacements.size(); idx++) {
+        stream << (idx % 16 ? " " : "\n    ") << displacements[idx] << ",";
+    }
+    stream << "\n};\n" << EPILOGUE << "} // namespace " << mNamespace << "\n";
+    return file.close();
+}
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "abi/itanium/ItaniumVTable.h"
+
+METADUMPER_OUTPUT_BEGIN
+
+// Writes the vtables as a self-contained C++17 header of constexpr arrays, for programs that would otherwise parse the
+// JSON output at startup:
+//
+//   if (auto table = metadump::findVTable("_ZTV6Player")) {
+//       auto& sub  = metadump::SUB_TABLES[table->mSubTableBegin]; // offset 0 first, as in the JSON output.
+//       auto  rva  = metadump::SLOTS[sub.mSlotBegin + 2].mRVA;
+//   }
+//
+// findVTable() is a minimal perfect hash (hash and displace): one hash to pick a displacement, one more to find the
+// only candidate, and a comparison of the names. The displacements are searched by finish(), VTABLES is laid out in
+// hash order, so a lookup allocates nothing and works in constant expressions too.
+class HeaderWriter {
+public:
+    // pNamespace encloses everything, e.g. "metadump" or "game::offsets".
+    HeaderWriter(std::string pPath, std::string pNamespace);
+
+    void add(const abi::itanium::VTable& pTable);
+
+    // Builds the hash and writes the header, returns false if anything failed. Without vtables, the header is still
+    // written with empty tables, findVTable() then always returns nullptr.
+    bool finish();
+
+    // Seeded FNV-1a with a final mix, identical to the generated hashName().
+    static uint64_t hashName(std::string_view pName, uint64_t pSeed);
+
+private:
+    struct Entry {
+        std::string                mName;
+        std::optional<std::string> mTypeName;
+        uint32_t                   mSubTableBegin;
+        uint32_t                   mSubTableCount;
+    };
+
+    struct SubTable {
+        ptrdiff_t mOffset;
+        uint32_t  mSlotBegin;
+        uint32_t  mSlotCount;
+    };
+
+    // Displacement of every bucket, and the entry of every hash slot.
+    std::pair<std::vector<int32_t>, std::vector<uint32_t>> _buildHash() const;
+
+    std::string mPath;
+    std::string mNamespace;
+
+    std::vector<Entry>                      mEntries;
+    std::vector<SubTable>                   mSubTables;
+    std::vector<abi::itanium::VTableColumn> mSlots;
+};
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,68 @@
+#include "JSONObjectWriter.h"
+
+METADUMPER_OUTPUT_BEGIN
+
+namespace {
+
+// dump(4) of pValue, pDepth levels deep: every line but the first is indented 4 * pDepth spaces more.
+void write_nested(std::ostream& pStream, const nlohmann::json& pValue, size_t pDepth) {
+    auto   pretty = pValue.dump(4);
+    auto   indent = std::string(4 * pDepth, ' ');
+    size_t begin  = 0;
+    for (auto end = pretty.find('\n'); end != std::string::npos; end = pretty.find('\n', begin)) {
+        pStream.write(pretty.data() + begin, (std::streamsize)(end + 1 - begin)) << indent;
+        begin = end + 1;
+    }
+    pStream.write(pretty.data() + begin, (std::streamsize)(pretty.size() - begin));
+}
+
+} // namespace
+
+JSONObjectWriter::JSONObjectWriter(std::string pPath) : mPath(std::move(pPath)) {}
+
+void JSONObjectWriter::add(const std::string& pName, const nlohmann::json& pEntry) {
+    if (!_beginEntry(pName)) return;
+    write_nested(mFile->stream(), pEntry, 1);
+}
+
+void JSONObjectWriter::addArray(
+    const std::string&                           pName,
+    size_t                                       pSize,
+    const std::function<nlohmann::json(size_t)>& pItem
+) {
+    if (!_beginEntry(pName)) return;
+    auto& stream = mFile->stream();
+    if (!pSize) {
+        stream << "[]";
+        return;
+    }
+    for (size_t idx = 0; idx < pSize; idx++) {
+        stream << (idx ? ",\n        " : "[\n        ");
+        write_nested(stream, pItem(idx), 2);
+    }
+    stream << "\n    ]";
+}
+
+bool JSONObjectWriter::_beginEntry(const std::string& pName) {
+    if (!mIsValid || mIsFinished) return false;
+    if (!mFile) {
+        mFile = std::make_unique<OutputFile>(mPath);
+        if (!mFile->isValid()) {
+            mIsValid = false;
+            return false;
+        }
+    }
+    mFile->stream() << (mCount++ ? ",\n    " : "{\n    ") << nlohmann::json(pName).dump() << ": ";
+    return true;
+}
+
+bool JSONObjectWriter::finish() {
+    if (!mIsValid || mIsFinished) return mIsValid;
+    mIsFinished = true;
+    if (!mFile) return true;
+    mFile->stream() << "\n}";
+    mIsValid = mFile->close();
+    return mIsValid;
+}
+
+METADUMPER_OUTPUT_END
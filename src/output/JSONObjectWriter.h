@@ -0,0 +1,42 @@
+#pragma once
+
+#include "OutputFile.h"
+
+#include "base/Base.h"
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+
+METADUMPER_OUTPUT_BEGIN
+
+// Writes one JSON object, {name: entry, ...}, entry by entry, in the same layout as dump(4) of the whole object, which
+// is never built. Only the entry being written is held, or a single item of an array entry.
+//
+// Entries are written in the order they are added: added sorted by name and without duplicates, the output is
+// byte-identical to dump(4). Like save_to_json(), nothing (not even the file) is written without entries.
+class JSONObjectWriter {
+public:
+    explicit JSONObjectWriter(std::string pPath);
+
+    void add(const std::string& pName, const nlohmann::json& pEntry);
+    // An array of pSize items, each built by pItem(index) when it is written.
+    void addArray(const std::string& pName, size_t pSize, const std::function<nlohmann::json(size_t)>& pItem);
+
+    // Closes the object, returns false if anything failed to open or write.
+    bool finish();
+
+    [[nodiscard]] size_t size() const { return mCount; }
+
+private:
+    // Opens the file on the first entry, writes the separator and the name. False if nothing can be written.
+    bool _beginEntry(const std::string& pName);
+
+    std::string                 mPath;
+    std::unique_ptr<OutputFile> mFile; // opened by the first entry.
+    size_t                      mCount{};
+    bool                        mIsValid{true};
+    bool                        mIsFinished{};
+};
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,46 @@
+#include "NDJSONWriter.h"
+
+using JSON = nlohmann::json;
+
+METADUMPER_OUTPUT_BEGIN
+
+NDJSONWriter::NDJSONWriter(const std::string& pPath, size_t pCapacity) : mFile(pPath), mQueue(pCapacity) {
+    if (mFile.isValid()) mWriter = std::thread(&NDJSONWriter::_run, this);
+}
+
+NDJSONWriter::~NDJSONWriter() { finish(); }
+
+void NDJSONWriter::push(abi::itanium::VTable&& pTable) { mQueue.push(std::move(pTable)); }
+
+void NDJSONWriter::push(const abi::itanium::TypeInfoTable& pTable, const abi::itanium::TypeInfo& pType) {
+    auto line    = pTable.toJson(pType);
+    line["kind"] = "typeinfo";
+    line["name"] = pTable.getName(pType.mName);
+    mQueue.push(std::move(line));
+}
+
+bool NDJSONWriter::finish() {
+    if (!mIsFinished) {
+        mIsFinished = true;
+        mQueue.close();
+        if (mWriter.joinable()) mWriter.join();
+    }
+    return mFile.close();
+}
+
+void NDJSONWriter::_run() {
+    auto& stream = mFile.stream();
+    while (auto record = mQueue.pop()) {
+        JSON line;
+        if (auto table = std::get_if<abi::itanium::VTable>(&*record)) {
+            line         = table->toJson();
+            line["kind"] = "vftable";
+            line["name"] = table->mName;
+        } else {
+            line = std::move(std::get<JSON>(*record));
+        }
+        stream << line.dump() << '\n';
+    }
+}
+
+METADUMPER_OUTPUT_END
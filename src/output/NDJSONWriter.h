@@ -0,0 +1,49 @@
+#pragma once
+
+#include "OutputFile.h"
+
+#include "base/Base.h"
+
+#include "abi/itanium/ItaniumVTable.h"
+#include "util/BoundedQueue.h"
+
+#include <thread>
+#include <variant>
+
+METADUMPER_OUTPUT_BEGIN
+
+// Writes one JSON record per line, as soon as each entry is decoded:
+//
+//   {"kind": "vftable", "name": "_ZTV...", "sub_tables": [...], "type_name": "_ZTI..."}
+//   {"kind": "typeinfo", "name": "_ZTI...", "inherit_type": "Single", ...}
+//
+// Serialization, compression and disk I/O run on a dedicated thread, fed through a bounded queue, so they overlap
+// with decoding and the memory held in between stays bounded.
+class NDJSONWriter {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    explicit NDJSONWriter(const std::string& pPath, size_t pCapacity = DEFAULT_CAPACITY);
+    ~NDJSONWriter();
+
+    [[nodiscard]] bool isValid() const { return mFile.isValid(); }
+
+    void push(abi::itanium::VTable&& pTable);
+    // The table keeps growing while decoding, so the record is converted right away, only dumped on the writer thread.
+    void push(const abi::itanium::TypeInfoTable& pTable, const abi::itanium::TypeInfo& pType);
+
+    // Waits for the writer thread, returns false if anything failed to write.
+    bool finish();
+
+private:
+    using Record = std::variant<abi::itanium::VTable, nlohmann::json>;
+
+    void _run();
+
+    OutputFile                 mFile;
+    util::BoundedQueue<Record> mQueue;
+    std::thread                mWriter;
+    bool                       mIsFinished{};
+};
+
+METADUMPER_OUTPUT_END
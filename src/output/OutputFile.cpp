@@ -0,0 +1,179 @@
+#include "OutputFile.h"
+
+#include <thread>
+
+#include <zlib.h>
+#include <zstd.h>
+
+METADUMPER_OUTPUT_BEGIN
+
+Compression detectCompression(const std::string& pPath) {
+    if (pPath.ends_with(".zst")) return Compression::Zstd;
+    if (pPath.ends_with(".gz")) return Compression::Gzip;
+    return Compression::None;
+}
+
+std::string_view getCompressionSuffix(Compression pCompression) {
+    switch (pCompression) {
+    case Compression::Zstd:
+        return ".zst";
+    case Compression::Gzip:
+        return ".gz";
+    case Compression::None:
+    default:
+        return "";
+    }
+}
+
+// Collects the formatted output in a fixed-size buffer and hands it to the compressor chunk by chunk.
+class CompressBuffer : public std::streambuf {
+public:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    explicit CompressBuffer(std::ofstream& pFile) : mFile(pFile), mInput(CHUNK_SIZE), mOutput(CHUNK_SIZE) {
+        setp(mInput.data(), mInput.data() + mInput.size());
+    }
+    ~CompressBuffer() override = default;
+
+    [[nodiscard]] bool isValid() const { return mIsValid; }
+
+    bool finish() { return _drain(true) && mFile.good(); }
+
+protected:
+    int_type overflow(int_type pChar) override {
+        if (!_drain(false)) return traits_type::eof();
+        if (!traits_type::eq_int_type(pChar, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(pChar);
+            pbump(1);
+        }
+        return traits_type::not_eof(pChar);
+    }
+
+    virtual bool _compress(const char* pData, size_t pSize, bool pEnd) = 0;
+
+    bool              mIsValid{true};
+    std::ofstream&    mFile;
+    std::vector<char> mInput;
+    std::vector<char> mOutput;
+
+private:
+    bool _drain(bool pEnd) {
+        auto ret = mIsValid && _compress(pbase(), pptr() - pbase(), pEnd);
+        setp(mInput.data(), mInput.data() + mInput.size());
+        return ret;
+    }
+};
+
+namespace {
+
+class ZstdBuffer : public CompressBuffer {
+public:
+    ZstdBuffer(std::ofstream& pFile, unsigned int pThreads) : CompressBuffer(pFile), mContext(ZSTD_createCCtx()) {
+        if (!mContext) {
+            mIsValid = false;
+            return;
+        }
+        ZSTD_CCtx_setParameter(mContext, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(ZSTD_CCtx_setParameter(mContext, ZSTD_c_nbWorkers, (int)pThreads))) {
+            spdlog::warn("zstd is built without multithread support, compressing with a single thread.");
+        }
+    }
+    ~ZstdBuffer() override { ZSTD_freeCCtx(mContext); }
+
+protected:
+    bool _compress(const char* pData, size_t pSize, bool pEnd) override {
+        ZSTD_inBuffer input{pData, pSize, 0};
+        auto          mode = pEnd ? ZSTD_e_end : ZSTD_e_continue;
+        while (true) {
+            ZSTD_outBuffer output{mOutput.data(), mOutput.size(), 0};
+            auto           remaining = ZSTD_compressStream2(mContext, &output, &input, mode);
+            if (ZSTD_isError(remaining)) {
+                spdlog::error("zstd: {}", ZSTD_getErrorName(remaining));
+                return mIsValid = false;
+            }
+            mFile.write(mOutput.data(), (std::streamsize)output.pos);
+            if (pEnd ? remaining == 0 : input.pos == input.size) break;
+        }
+        return mFile.good();
+    }
+
+private:
+    ZSTD_CCtx* mContext;
+};
+
+class GzipBuffer : public CompressBuffer {
+public:
+    explicit GzipBuffer(std::ofstream& pFile) : CompressBuffer(pFile) {
+        // 15 + 16: max window, with gzip header.
+        if (deflateInit2(&mStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            mIsValid = false;
+        }
+    }
+    ~GzipBuffer() override { deflateEnd(&mStream); }
+
+protected:
+    bool _compress(const char* pData, size_t pSize, bool pEnd) override {
+        mStream.next_in  = (Bytef*)pData;
+        mStream.avail_in = (uInt)pSize;
+        int ret;
+        do {
+            mStream.next_out  = (Bytef*)mOutput.data();
+            mStream.avail_out = (uInt)mOutput.size();
+            ret               = deflate(&mStream, pEnd ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) {
+                spdlog::error("zlib: {}", mStream.msg ? mStream.msg : "stream error");
+                return mIsValid = false;
+            }
+            mFile.write(mOutput.data(), (std::streamsize)(mOutput.size() - mStream.avail_out));
+        } while (mStream.avail_out == 0);
+        return mFile.good() && (!pEnd || ret == Z_STREAM_END);
+    }
+
+private:
+    z_stream mStream{};
+};
+
+} // namespace
+
+OutputFile::OutputFile(const std::string& pPath, unsigned int pThreads)
+: OutputFile(pPath, detectCompression(pPath), pThreads) {}
+
+OutputFile::OutputFile(const std::string& pPath, Compression pCompression, unsigned int pThreads)
+: mFile(pPath, std::ios::binary | std::ios::trunc),
+  mStream(nullptr) {
+    if (!mFile.is_open()) {
+        mIsValid = false;
+        return;
+    }
+    if (!pThreads) pThreads = std::max(1u, std::thread::hardware_concurrency());
+    switch (pCompression) {
+    case Compression::Zstd:
+        mBuffer = std::make_unique<ZstdBuffer>(mFile, pThreads);
+        break;
+    case Compression::Gzip:
+        mBuffer = std::make_unique<GzipBuffer>(mFile);
+        break;
+    case Compression::None:
+        mStream.rdbuf(mFile.rdbuf());
+        return;
+    }
+    if (!mBuffer->isValid()) {
+        spdlog::error("Failed to initialize compressor.");
+        mIsValid = false;
+        return;
+    }
+    mStream.rdbuf(mBuffer.get());
+}
+
+OutputFile::~OutputFile() { close(); }
+
+bool OutputFile::close() {
+    if (mIsClosed || !mIsValid) return mIsValid;
+    mIsClosed = true;
+    mStream.flush();
+    if (mBuffer && !mBuffer->finish()) mIsValid = false;
+    mFile.close();
+    return mIsValid = mIsValid && mStream.good() && !mFile.fail();
+}
+
+METADUMPER_OUTPUT_END
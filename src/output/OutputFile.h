@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <fstream>
+
+METADUMPER_OUTPUT_BEGIN
+
+enum class Compression { None, Gzip, Zstd };
+
+// By extension: ".gz" or ".zst".
+Compression detectCompression(const std::string& pPath);
+
+std::string_view getCompressionSuffix(Compression pCompression);
+
+class CompressBuffer;
+
+// Output file that compresses on the fly, so that the data only goes to disk once.
+//
+//   OutputFile file("sample.vftable.json.zst");
+//   file.stream() << json;
+//   file.close();
+//
+// Zstd frames are compressed by pThreads workers (0 = hardware concurrency).
+class OutputFile {
+public:
+    explicit OutputFile(const std::string& pPath, unsigned int pThreads = 0);
+    OutputFile(const std::string& pPath, Compression pCompression, unsigned int pThreads = 0);
+    ~OutputFile();
+
+    OutputFile(const OutputFile&)            = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    [[nodiscard]] bool isValid() const { return mIsValid; }
+
+    std::ostream& stream() { return mStream; }
+
+    // Flushes and finishes the compressed stream, returns false if anything failed to write.
+    bool close();
+
+private:
+    bool mIsValid{true};
+    bool mIsClosed{};
+
+    std::ofstream                   mFile;
+    std::unique_ptr<CompressBuffer> mBuffer;
+    std::ostream                    mStream;
+};
+
+METADUMPER_OUTPUT_END
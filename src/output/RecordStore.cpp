@@ -0,0 +1,261 @@
+#include "RecordStore.h"
+
+#include <bit>
+#include <charconv>
+#include <filesystem>
+#include <iomanip>
+
+using JSON = nlohmann::json;
+
+METADUMPER_OUTPUT_BEGIN
+
+namespace {
+
+constexpr std::string_view RECORDS_FILE     = "records.ndjson";
+constexpr std::string_view MANIFESTS_FOLDER = "manifests";
+constexpr std::string_view LINE_PREFIX      = R"({"id":")";
+constexpr size_t           ID_LENGTH        = 32;
+
+// 128 bits from two independent lanes, FNV-1a and a multiply-rotate finished with the murmur3 mix, so that distinct
+// records don't share an ID in practice. Fields are length-prefixed so that their boundaries count.
+class Hasher {
+public:
+    Hasher& add(std::string_view pData) {
+        add((uint64_t)pData.size());
+        for (auto chr : pData) _byte((uint8_t)chr);
+        return *this;
+    }
+
+    Hasher& add(const std::string& pData) { return add(std::string_view(pData)); }
+
+    Hasher& add(const std::optional<std::string>& pData) {
+        add((uint64_t)pData.has_value());
+        if (pData) add(*pData);
+        return *this;
+    }
+
+    template <typename T>
+        requires std::is_integral_v<T>
+    Hasher& add(T pValue) {
+        auto value = (uint64_t)pValue;
+        for (size_t i = 0; i < sizeof(uint64_t); i++) _byte((uint8_t)(value >> (i * 8)));
+        return *this;
+    }
+
+    [[nodiscard]] RecordStore::Id get() const {
+        auto high = mHigh;
+        high ^= high >> 33;
+        high *= 0xff51afd7ed558ccd;
+        high ^= high >> 33;
+        high *= 0xc4ceb9fe1a85ec53;
+        high ^= high >> 33;
+        return {high, mLow};
+    }
+
+private:
+    void _byte(uint8_t pByte) {
+        mLow ^= pByte;
+        mLow *= 0x100000001b3;
+        mHigh = std::rotl((mHigh ^ pByte) * 0x9e3779b97f4a7c15, 27);
+    }
+
+    uint64_t mHigh{0x6a09e667f3bcc908};
+    uint64_t mLow{0xcbf29ce484222325};
+};
+
+RecordStore::Id hash_of(const abi::itanium::VTable& pTable) {
+    Hasher hasher;
+    hasher.add(std::string_view("vftable")).add(pTable.mName).add(pTable.mTypeName);
+    for (auto& [offset, columns] : pTable.mSubTables) {
+        hasher.add(offset).add(columns.size());
+        for (auto& column : columns) hasher.add(column.mSymbolName).add(column.mLibrary);
+    }
+    return hasher.get();
+}
+
+RecordStore::Id hash_of(const abi::itanium::TypeInfoTable& pTable, const abi::itanium::TypeInfo& pType) {
+    using namespace abi::itanium;
+    Hasher hasher;
+    hasher.add(std::string_view("typeinfo")).add(pTable.getName(pType.mName)).add((int)pType.mKind);
+    switch (pType.mKind) {
+    case TypeInheritKind::Single:
+        hasher.add(pTable.getName(pType.mParentType)).add(pType.mOffset);
+        break;
+    case TypeInheritKind::Multiple: {
+        auto bases = pTable.getBases(pType);
+        hasher.add(pType.mAttribute).add(bases.size());
+        for (auto& base : bases) hasher.add(pTable.getName(base.mName)).add(base.mOffset).add(base.mMask);
+        break;
+    }
+    case TypeInheritKind::None:
+    default:
+        break;
+    }
+    return hasher.get();
+}
+
+std::string format_id(const RecordStore::Id& pId) { return fmt::format("{:016x}{:016x}", pId.mHigh, pId.mLow); }
+
+// The ID of a records line, nullopt unless it starts with exactly ID_LENGTH hex digits and a quote.
+std::optional<RecordStore::Id> parse_id(std::string_view pLine) {
+    if (!pLine.starts_with(LINE_PREFIX) || pLine.size() <= LINE_PREFIX.size() + ID_LENGTH) return std::nullopt;
+    auto            begin = pLine.data() + LINE_PREFIX.size();
+    auto            half  = begin + ID_LENGTH / 2;
+    auto            end   = begin + ID_LENGTH;
+    RecordStore::Id ret;
+    auto [highEnd, highError] = std::from_chars(begin, half, ret.mHigh, 16);
+    auto [lowEnd, lowError]   = std::from_chars(half, end, ret.mLow, 16);
+    if (highError != std::errc{} || highEnd != half || lowError != std::errc{} || lowEnd != end || *end != '"') {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+// <name>.<hash of the absolute path>.json, so binaries of the same name in different folders (e.g. one per ABI) don't
+// overwrite each other's manifest, while ingesting the same path again replaces it.
+std::string get_manifest_name(const std::string& pBinary) {
+    std::error_code error;
+    auto            path = std::filesystem::weakly_canonical(pBinary, error);
+    if (error) path = std::filesystem::absolute(pBinary, error);
+    auto hash = Hasher().add(path.generic_string()).get().mLow;
+    return fmt::format("{}.{:08x}.json", std::filesystem::path(pBinary).filename().string(), (uint32_t)hash);
+}
+
+} // namespace
+
+RecordStore::RecordStore(std::string pDirectory) : mDirectory(std::move(pDirectory)) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(mDirectory) / MANIFESTS_FOLDER, error);
+    if (error) {
+        spdlog::error("Failed to create {}: {}", mDirectory, error.message());
+        mIsValid = false;
+        return;
+    }
+
+    // Index the existing records, a line cut by an interrupted run doesn't count.
+    auto          recordsPath  = std::filesystem::path(mDirectory) / RECORDS_FILE;
+    bool          isTerminated = true;
+    std::ifstream records(recordsPath);
+    for (std::string line; std::getline(records, line);) {
+        isTerminated = !records.eof();
+        if (!isTerminated) continue;
+        if (auto id = parse_id(line)) mIds.emplace(*id);
+    }
+    records.close();
+
+    mRecords.open(recordsPath, std::ios::app);
+    if (!mRecords.is_open()) {
+        spdlog::error("Failed to open {}!", recordsPath.string());
+        mIsValid = false;
+        return;
+    }
+    if (!isTerminated) mRecords << '\n';
+}
+
+std::string RecordStore::_add(const Id& pId, const std::function<JSON()>& pSerialize) {
+    // Known records are not serialized again.
+    if (mIds.emplace(pId).second) {
+        mRecords << JSON{
+            {"id",     format_id(pId)},
+            {"record", pSerialize()  }
+        }.dump() << '\n';
+        mAddedCount++;
+    } else {
+        mKnownCount++;
+    }
+    return format_id(pId);
+}
+
+bool RecordStore::ingest(
+    const std::string&                      pBinary,
+    const abi::itanium::DumpVFTableResult&  pVFTable,
+    const abi::itanium::DumpTypeInfoResult& pTypeInfo
+) {
+    if (!mIsValid) return false;
+    mAddedCount = 0;
+    mKnownCount = 0;
+
+    auto vftable = JSON::object();
+    for (auto& table : pVFTable.mVFTable) {
+        auto id = _add(hash_of(table), [&]() {
+            auto subTables = JSON::array();
+            for (auto& [offset, columns] : table.mSubTables) {
+                auto symbols    = JSON::array();
+                auto libraries  = JSON::array();
+                bool hasLibrary = false;
+                for (auto& column : columns) {
+                    symbols.emplace_back(column.mSymbolName ? JSON(*column.mSymbolName) : JSON{});
+                    libraries.emplace_back(column.mLibrary ? JSON(*column.mLibrary) : JSON{});
+                    hasLibrary |= column.mLibrary.has_value();
+                }
+                auto& subTable = subTables.emplace_back(JSON{
+                    {"offset",  offset },
+                    {"symbols", symbols}
+                });
+                // Defining library of each external slot, omitted for tables without any.
+                if (hasLibrary) subTable["libraries"] = std::move(libraries);
+            }
+            return JSON{
+                {"kind",       "vftable"                                                    },
+                {"name",       table.mName                                                  },
+                {"type_name",  table.mTypeName.has_value() ? JSON(*table.mTypeName) : JSON{}},
+                {"sub_tables", subTables                                                    }
+            };
+        });
+        auto rva = JSON::array();
+        for (auto& [offset, columns] : table.mSubTables) {
+            auto& slots = rva.emplace_back(JSON::array());
+            for (auto& column : columns) slots.emplace_back(column.mRVA);
+        }
+        vftable[table.mName] = JSON{
+            {"id",  id },
+            {"rva", rva}
+        };
+    }
+
+    auto  typeinfo = JSON::object();
+    auto& types    = pTypeInfo.mTypeInfo;
+    for (auto& type : types) {
+        auto& name     = types.getName(type.mName);
+        typeinfo[name] = _add(hash_of(types, type), [&]() {
+            auto record    = types.toJson(type);
+            record["kind"] = "typeinfo";
+            record["name"] = name;
+            return record;
+        });
+    }
+
+    mRecords.flush();
+    if (!mRecords.good()) {
+        spdlog::error("Failed to write {}!", (std::filesystem::path(mDirectory) / RECORDS_FILE).string());
+        return false;
+    }
+
+    JSON manifest{
+        {"binary",   pBinary },
+        {"vftable",  vftable },
+        {"typeinfo", typeinfo}
+    };
+    auto manifestPath = std::filesystem::path(mDirectory) / MANIFESTS_FOLDER / get_manifest_name(pBinary);
+    std::ofstream manifestFile(manifestPath, std::ios::trunc);
+    if (!manifestFile.is_open()) {
+        spdlog::error("Failed to open {}!", manifestPath.string());
+        return false;
+    }
+    manifestFile << std::setw(4) << manifest;
+    manifestFile.close();
+    if (manifestFile.fail()) {
+        spdlog::error("Failed to write {}!", manifestPath.string());
+        return false;
+    }
+
+    spdlog::info(
+        "Stored {} new record(s), {} already known, manifest: {}",
+        mAddedCount,
+        mKnownCount,
+        manifestPath.string()
+    );
+    return true;
+}
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "abi/itanium/ItaniumVTableReader.h"
+
+#include <fstream>
+#include <unordered_set>
+
+METADUMPER_OUTPUT_BEGIN
+
+// Append-only store shared by many binaries, each unique record is written once:
+//
+//   <dir>/records.ndjson            {"id": "<128-bit hash>", "record": {...}}, one per line
+//   <dir>/manifests/<binary>.<path hash>.json
+//                                   {"binary": ..., "vftable": {name: {"id", "rva"}}, "typeinfo": {name: id}}
+//
+// Records are identified by a hash of their content: the name, and the slot symbols and libraries of a vtable or the
+// bases of a typeinfo. Slot RVAs differ between binaries, so they are kept in the manifest instead. Only one process
+// may write to a store at a time. Lines without a valid ID, e.g. cut by an interrupted run or with the 64-bit IDs of
+// older stores, are ignored.
+class RecordStore {
+public:
+    struct Id {
+        uint64_t mHigh;
+        uint64_t mLow;
+
+        bool operator==(const Id&) const = default;
+    };
+
+    explicit RecordStore(std::string pDirectory);
+
+    [[nodiscard]] bool isValid() const { return mIsValid; }
+
+    // Adds every record not in the store yet, then (re)writes the manifest of pBinary.
+    bool ingest(
+        const std::string&                      pBinary,
+        const abi::itanium::DumpVFTableResult&  pVFTable,
+        const abi::itanium::DumpTypeInfoResult& pTypeInfo
+    );
+
+    [[nodiscard]] size_t getRecordCount() const { return mIds.size(); }
+
+private:
+    struct IdHash {
+        size_t operator()(const Id& pId) const { return pId.mLow ^ pId.mHigh; }
+    };
+
+    std::string _add(const Id& pId, const std::function<nlohmann::json()>& pSerialize);
+
+    bool mIsValid{true};
+
+    std::string                    mDirectory;
+    std::ofstream                  mRecords;
+    std::unordered_set<Id, IdHash> mIds;
+    size_t                         mAddedCount{};
+    size_t                         mKnownCount{};
+};
+
+METADUMPER_OUTPUT_END
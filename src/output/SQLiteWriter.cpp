@@ -0,0 +1,224 @@
+#include "SQLiteWriter.h"
+
+#include <sqlite3.h>
+
+#include <filesystem>
+
+METADUMPER_OUTPUT_BEGIN
+
+namespace {
+
+// Tables only, the indexes are created once all rows are in.
+constexpr const char* SCHEMA = R"(
+CREATE TABLE vtables (
+    id        INTEGER PRIMARY KEY,
+    name      TEXT NOT NULL,
+    type_name TEXT
+);
+CREATE TABLE sub_tables (
+    id     INTEGER PRIMARY KEY,
+    vtable INTEGER NOT NULL REFERENCES vtables (id),
+    offset INTEGER NOT NULL
+);
+CREATE TABLE slots (
+    sub_table INTEGER NOT NULL REFERENCES sub_tables (id),
+    idx       INTEGER NOT NULL,
+    symbol    TEXT,
+    rva       INTEGER,
+    library   TEXT,
+    PRIMARY KEY (sub_table, idx)
+) WITHOUT ROWID;
+CREATE TABLE typeinfos (
+    id           INTEGER PRIMARY KEY,
+    name         TEXT NOT NULL,
+    inherit_type TEXT NOT NULL,
+    parent_type  TEXT,
+    offset       INTEGER,
+    attribute    INTEGER
+);
+CREATE TABLE base_classes (
+    typeinfo INTEGER NOT NULL REFERENCES typeinfos (id),
+    idx      INTEGER NOT NULL,
+    name     TEXT NOT NULL,
+    offset   INTEGER NOT NULL,
+    mask     INTEGER NOT NULL,
+    PRIMARY KEY (typeinfo, idx)
+) WITHOUT ROWID;
+)";
+
+constexpr const char* INDEXES = R"(
+CREATE INDEX vtables_name ON vtables (name);
+CREATE INDEX vtables_type_name ON vtables (type_name);
+CREATE INDEX sub_tables_vtable ON sub_tables (vtable);
+CREATE INDEX slots_rva ON slots (rva);
+CREATE INDEX slots_symbol ON slots (symbol);
+CREATE INDEX typeinfos_name ON typeinfos (name);
+CREATE INDEX typeinfos_parent_type ON typeinfos (parent_type);
+CREATE INDEX base_classes_name ON base_classes (name);
+ANALYZE;
+)";
+
+constexpr const char* STATEMENTS[] = {
+    "INSERT INTO vtables VALUES (?, ?, ?)",
+    "INSERT INTO sub_tables VALUES (?, ?, ?)",
+    "INSERT INTO slots VALUES (?, ?, ?, ?, ?)",
+    "INSERT INTO typeinfos VALUES (?, ?, ?, ?, ?, ?)",
+    "INSERT INTO base_classes VALUES (?, ?, ?, ?, ?)",
+};
+
+void bind_text(sqlite3_stmt* pStatement, int pIndex, std::string_view pText) {
+    // Bound values only have to live until the statement is stepped.
+    sqlite3_bind_text(pStatement, pIndex, pText.data(), (int)pText.size(), SQLITE_STATIC);
+}
+
+void bind_optional_text(sqlite3_stmt* pStatement, int pIndex, const std::optional<std::string>& pText) {
+    if (pText) bind_text(pStatement, pIndex, *pText);
+    else sqlite3_bind_null(pStatement, pIndex);
+}
+
+} // namespace
+
+SQLiteWriter::SQLiteWriter(const std::string& pPath) {
+    std::error_code error;
+    std::filesystem::remove(pPath, error);
+    if (sqlite3_open(pPath.c_str(), &mDatabase) != SQLITE_OK) {
+        spdlog::error("Failed to open {}: {}", pPath, sqlite3_errmsg(mDatabase));
+        sqlite3_close(mDatabase);
+        mDatabase = nullptr;
+        return;
+    }
+    try {
+        // A new file, written once: nothing to roll back to if the export fails.
+        _execute("PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA locking_mode = EXCLUSIVE;");
+        _execute(SCHEMA);
+        for (int idx = 0; idx < StatementCount; idx++) {
+            _check(sqlite3_prepare_v2(mDatabase, STATEMENTS[idx], -1, &mStatements[idx], nullptr), "prepare");
+        }
+        _execute("BEGIN");
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        for (auto& statement : mStatements) {
+            sqlite3_finalize(statement);
+            statement = nullptr;
+        }
+        sqlite3_close(mDatabase);
+        mDatabase = nullptr;
+    }
+}
+
+SQLiteWriter::~SQLiteWriter() {
+    finish();
+    for (auto& statement : mStatements) sqlite3_finalize(statement);
+    sqlite3_close(mDatabase);
+}
+
+void SQLiteWriter::add(const abi::itanium::VTable& pTable) {
+    auto vtable    = ++mVTableCount;
+    auto statement = mStatements[InsertVTable];
+    sqlite3_bind_int64(statement, 1, vtable);
+    bind_text(statement, 2, pTable.mName);
+    bind_optional_text(statement, 3, pTable.mTypeName);
+    _step(InsertVTable);
+
+    for (auto& [offset, columns] : pTable.mSubTables) {
+        auto subTable = ++mSubTableCount;
+        statement     = mStatements[InsertSubTable];
+        sqlite3_bind_int64(statement, 1, subTable);
+        sqlite3_bind_int64(statement, 2, vtable);
+        sqlite3_bind_int64(statement, 3, (int64_t)offset);
+        _step(InsertSubTable);
+
+        statement = mStatements[InsertSlot];
+        for (size_t idx = 0; idx < columns.size(); idx++) {
+            auto& column = columns[idx];
+            sqlite3_bind_int64(statement, 1, subTable);
+            sqlite3_bind_int64(statement, 2, (int64_t)idx);
+            bind_optional_text(statement, 3, column.mSymbolName);
+            // Same as the JSON output, 0 for unknown external functions.
+            sqlite3_bind_int64(statement, 4, (int64_t)column.mRVA);
+            bind_optional_text(statement, 5, column.mLibrary);
+            _step(InsertSlot);
+        }
+    }
+}
+
+void SQLiteWriter::add(const abi::itanium::TypeInfoTable& pTable, const abi::itanium::TypeInfo& pType) {
+    using namespace abi::itanium;
+
+    auto typeInfo  = ++mTypeInfoCount;
+    auto statement = mStatements[InsertTypeInfo];
+    sqlite3_bind_int64(statement, 1, typeInfo);
+    bind_text(statement, 2, pTable.getName(pType.mName));
+    for (int idx = 4; idx <= 6; idx++) sqlite3_bind_null(statement, idx);
+    switch (pType.mKind) {
+    case TypeInheritKind::Single:
+        bind_text(statement, 3, "Single");
+        bind_text(statement, 4, pTable.getName(pType.mParentType));
+        sqlite3_bind_int64(statement, 5, (int64_t)pType.mOffset);
+        break;
+    case TypeInheritKind::Multiple:
+        bind_text(statement, 3, "Multiple");
+        sqlite3_bind_int64(statement, 6, pType.mAttribute);
+        break;
+    case TypeInheritKind::None:
+    default:
+        bind_text(statement, 3, "None");
+        break;
+    }
+    _step(InsertTypeInfo);
+
+    auto bases = pTable.getBases(pType);
+    statement  = mStatements[InsertBaseClass];
+    for (size_t idx = 0; idx < bases.size(); idx++) {
+        sqlite3_bind_int64(statement, 1, typeInfo);
+        sqlite3_bind_int64(statement, 2, (int64_t)idx);
+        bind_text(statement, 3, pTable.getName(bases[idx].mName));
+        sqlite3_bind_int64(statement, 4, (int64_t)bases[idx].mOffset);
+        sqlite3_bind_int64(statement, 5, bases[idx].mMask);
+        _step(InsertBaseClass);
+    }
+}
+
+bool SQLiteWriter::finish() {
+    if (!mDatabase || mIsFinished) return mDatabase != nullptr;
+    mIsFinished = true;
+    try {
+        _execute("COMMIT");
+        _execute(INDEXES);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        return false;
+    }
+    return true;
+}
+
+void SQLiteWriter::_execute(const char* pSql) {
+    char* message{};
+    if (sqlite3_exec(mDatabase, pSql, nullptr, nullptr, &message) != SQLITE_OK) {
+        std::string what = message ? message : "unknown error";
+        sqlite3_free(message);
+        throw std::runtime_error(fmt::format("SQLite: {}", what));
+    }
+}
+
+void SQLiteWriter::_check(int pResult, const char* pWhat) const {
+    if (pResult != SQLITE_OK && pResult != SQLITE_DONE) {
+        throw std::runtime_error(fmt::format("SQLite: failed to {}: {}", pWhat, sqlite3_errmsg(mDatabase)));
+    }
+}
+
+void SQLiteWriter::_step(Statement pStatement) {
+    auto statement = mStatements[pStatement];
+    auto result    = sqlite3_step(statement);
+    sqlite3_reset(statement);
+    _check(result, "insert");
+    _countRow();
+}
+
+void SQLiteWriter::_countRow() {
+    if (++mPendingRows < BATCH_ROWS) return;
+    mPendingRows = 0;
+    _execute("COMMIT; BEGIN");
+}
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "abi/itanium/ItaniumVTable.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+METADUMPER_OUTPUT_BEGIN
+
+// Writes the results to a SQLite database, one normalized table per kind of record:
+//
+//   vtables      (id, name, type_name)
+//   sub_tables   (id, vtable, offset)
+//   slots        (sub_table, idx, symbol, rva, library)
+//   typeinfos    (id, name, inherit_type, parent_type, offset, attribute)
+//   base_classes (typeinfo, idx, name, offset, mask)
+//
+// Rows are inserted through prepared statements, in transactions of BATCH_ROWS, and the indexes (names, slot RVAs
+// and symbols, parent types) are only created by finish(), which is much faster than maintaining them row by row.
+class SQLiteWriter {
+public:
+    static constexpr size_t BATCH_ROWS = 256 * 1024;
+
+    // An existing database at pPath is replaced.
+    explicit SQLiteWriter(const std::string& pPath);
+    ~SQLiteWriter();
+
+    SQLiteWriter(const SQLiteWriter&)            = delete;
+    SQLiteWriter& operator=(const SQLiteWriter&) = delete;
+
+    [[nodiscard]] bool isValid() const { return mDatabase != nullptr; }
+
+    // Throw std::runtime_error if a row can't be inserted.
+    void add(const abi::itanium::VTable& pTable);
+    void add(const abi::itanium::TypeInfoTable& pTable, const abi::itanium::TypeInfo& pType);
+
+    // Commits the last rows and creates the indexes, returns false if anything failed.
+    bool finish();
+
+private:
+    enum Statement { InsertVTable, InsertSubTable, InsertSlot, InsertTypeInfo, InsertBaseClass, StatementCount };
+
+    void _execute(const char* pSql);
+    void _check(int pResult, const char* pWhat) const;
+    void _step(Statement pStatement);
+    void _countRow();
+
+    sqlite3*      mDatabase{};
+    sqlite3_stmt* mStatements[StatementCount]{};
+
+    int64_t mVTableCount{};
+    int64_t mSubTableCount{};
+    int64_t mTypeInfoCount{};
+    size_t  mPendingRows{};
+    bool    mIsFinished{};
+};
+
+METADUMPER_OUTPUT_END
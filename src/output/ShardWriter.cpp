@@ -0,0 +1,185 @@
+#include "ShardWriter.h"
+#include "OutputFile.h"
+
+#include "util/Parallel.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+using JSON = nlohmann::json;
+
+METADUMPER_OUTPUT_BEGIN
+
+namespace {
+
+// Reserved identifier, can't clash with a real namespace.
+constexpr std::string_view GLOBAL_NAMESPACE = "__global";
+
+struct TopLevelName {
+    std::string mName;      // first source name, e.g. "foo" of foo::Bar, "Player" of ::Player.
+    std::string mNamespace; // GLOBAL_NAMESPACE if not nested.
+};
+
+// Reference:
+// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#mangling
+TopLevelName parse_top_level_name(std::string_view pName) {
+    while (pName.starts_with('_')) pName.remove_prefix(1); // Mach-O has one more.
+    if (!(pName.starts_with("ZTV") || pName.starts_with("ZTI") || pName.starts_with("ZTS"))) return {};
+    pName.remove_prefix(3);
+
+    bool nested = pName.starts_with('N');
+    if (nested) {
+        pName.remove_prefix(1);
+        while (!pName.empty() && std::string_view("rVKRO").find(pName.front()) != std::string_view::npos) {
+            pName.remove_prefix(1);
+        }
+    }
+    if (pName.starts_with("St")) return {"std", "std"};
+
+    size_t length = 0, idx = 0;
+    for (; idx < pName.size() && std::isdigit((unsigned char)pName[idx]); idx++) {
+        length = length * 10 + pName[idx] - '0';
+    }
+    if (!idx || idx + length > pName.size()) return {};
+    auto name = std::string(pName.substr(idx, length));
+    return {name, nested ? name : std::string(GLOBAL_NAMESPACE)};
+}
+
+std::string sanitize(std::string pKey) {
+    for (auto& chr : pKey) {
+        if (!std::isalnum((unsigned char)chr) && chr != '_') chr = '_';
+    }
+    return pKey.empty() ? "_" : pKey;
+}
+
+} // namespace
+
+std::optional<ShardMode> parseShardMode(std::string_view pMode) {
+    if (pMode == "namespace") return ShardMode::Namespace;
+    if (pMode == "prefix") return ShardMode::Prefix;
+    if (pMode == "count") return ShardMode::Count;
+    return std::nullopt;
+}
+
+std::string_view getShardModeName(ShardMode pMode) {
+    switch (pMode) {
+    case ShardMode::Namespace:
+        return "namespace";
+    case ShardMode::Prefix:
+        return "prefix";
+    case ShardMode::Count:
+    default:
+        return "count";
+    }
+}
+
+ShardWriter::ShardWriter(std::string pBase, std::string pCompressionSuffix, ShardOptions pOptions)
+: mBase(std::move(pBase)),
+  mCompressionSuffix(std::move(pCompressionSuffix)),
+  mOptions(pOptions) {
+    mOptions.mCount        = std::max<size_t>(mOptions.mCount, 1);
+    mOptions.mPrefixLength = std::max<size_t>(mOptions.mPrefixLength, 1);
+}
+
+std::string ShardWriter::_getKey(const std::string& pName, size_t pIndex, size_t pTotal) const {
+    switch (mOptions.mMode) {
+    case ShardMode::Namespace:
+        return sanitize(parse_top_level_name(pName).mNamespace);
+    case ShardMode::Prefix:
+        return sanitize(parse_top_level_name(pName).mName.substr(0, mOptions.mPrefixLength));
+    case ShardMode::Count:
+    default:
+        return fmt::format("{:04}", pIndex * mOptions.mCount / pTotal);
+    }
+}
+
+void ShardWriter::add(const std::string& pKind, const JSON& pEntries) {
+    if (!pEntries.is_object()) return;
+    std::unordered_map<std::string, size_t> shardByKey;
+
+    size_t idx = 0;
+    for (auto& [name, entry] : pEntries.items()) {
+        auto key            = _getKey(name, idx++, pEntries.size());
+        auto [it, inserted] = shardByKey.try_emplace(key, mShards.size());
+        if (inserted) {
+            auto fileName = fmt::format("{}.{}.{}.json{}", mBase, pKind, key, mCompressionSuffix);
+            mShards.emplace_back(Shard{pKind, key, fileName});
+        }
+        auto& shard = mShards[it->second];
+        shard.mEntries.emplace_back(&entry);
+        shard.mNames.emplace_back(&name);
+        auto ns = parse_top_level_name(name).mNamespace;
+        shard.mNamespaces.emplace(ns.empty() ? std::string(GLOBAL_NAMESPACE) : ns);
+    }
+}
+
+bool ShardWriter::write() {
+    // Per shard, logged afterwards: the default logger is single-threaded.
+    enum class Status : uint8_t { Written, OpenFailed, WriteFailed };
+    std::vector<Status> status(mShards.size(), Status::Written);
+
+    util::parallelFor(
+        mShards.size(),
+        [&](size_t pIndex) {
+            auto& shard = mShards[pIndex];
+            JSON  content;
+            for (size_t i = 0; i < shard.mEntries.size(); i++) content[*shard.mNames[i]] = *shard.mEntries[i];
+            OutputFile file(shard.mFileName, 1);
+            if (!file.isValid()) {
+                status[pIndex] = Status::OpenFailed;
+                return;
+            }
+            file.stream() << std::setw(4) << content;
+            if (!file.close()) status[pIndex] = Status::WriteFailed;
+        },
+        mOptions.mThreads
+    );
+
+    bool succeed = true;
+    for (size_t idx = 0; idx < mShards.size(); idx++) {
+        if (status[idx] == Status::Written) continue;
+        if (status[idx] == Status::OpenFailed) spdlog::error("Failed to open {}!", mShards[idx].mFileName);
+        else spdlog::error("Failed to write {}!", mShards[idx].mFileName);
+        succeed = false;
+    }
+
+    // Manifest
+    auto shards     = JSON::array();
+    auto namespaces = JSON::object();
+    for (size_t idx = 0; idx < mShards.size(); idx++) {
+        auto& shard    = mShards[idx];
+        auto  fileName = std::filesystem::path(shard.mFileName).filename().string();
+        shards.emplace_back(JSON{
+            {"kind",  shard.mKind          },
+            {"key",   shard.mKey           },
+            {"file",  fileName             },
+            {"count", shard.mEntries.size()},
+            {"first", *shard.mNames.front()},
+            {"last",  *shard.mNames.back() }
+        });
+        for (auto& ns : shard.mNamespaces) namespaces[ns].emplace_back(idx);
+    }
+    JSON manifest{
+        {"mode",       getShardModeName(mOptions.mMode)},
+        {"shards",     shards                          },
+        {"namespaces", namespaces                      }
+    };
+    auto          manifestName = mBase + ".manifest.json";
+    std::ofstream manifestFile(manifestName, std::ios::trunc);
+    if (!manifestFile.is_open()) {
+        spdlog::error("Failed to open {}!", manifestName);
+        return false;
+    }
+    manifestFile << std::setw(4) << manifest;
+    manifestFile.close();
+    if (manifestFile.fail()) {
+        spdlog::error("Failed to write {}!", manifestName);
+        return false;
+    }
+
+    if (succeed) spdlog::info("Results have been saved to {} shard(s), manifest: {}", mShards.size(), manifestName);
+    return succeed;
+}
+
+METADUMPER_OUTPUT_END
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <nlohmann/json.hpp>
+
+#include <set>
+
+METADUMPER_OUTPUT_BEGIN
+
+enum class ShardMode { Namespace, Prefix, Count };
+
+std::optional<ShardMode> parseShardMode(std::string_view pMode);
+std::string_view         getShardModeName(ShardMode pMode);
+
+struct ShardOptions {
+    ShardMode    mMode{ShardMode::Namespace};
+    size_t       mCount{16};       // Count: number of shards per kind.
+    size_t       mPrefixLength{1}; // Prefix: characters of the top-level name.
+    unsigned int mThreads{};       // 0 = hardware concurrency.
+};
+
+// Splits the name -> entry results into many small files plus a manifest, so that consumers can load only what
+// they need:
+//
+//   <base>.manifest.json
+//   <base>.<kind>.<key>.json[.gz|.zst]
+//
+// The manifest lists every shard with its name range, and maps each top-level namespace to the shards holding it.
+class ShardWriter {
+public:
+    ShardWriter(std::string pBase, std::string pCompressionSuffix, ShardOptions pOptions);
+
+    // pEntries is a JSON object (sorted by name), e.g. DumpVFTableResult::toJson(). It is referenced, not copied,
+    // so it must outlive write().
+    void add(const std::string& pKind, const nlohmann::json& pEntries);
+
+    // Shards are written in parallel, the manifest last.
+    bool write();
+
+private:
+    struct Shard {
+        std::string                        mKind;
+        std::string                        mKey;
+        std::string                        mFileName;
+        std::vector<const nlohmann::json*> mEntries;
+        std::vector<const std::string*>    mNames;
+        std::set<std::string>              mNamespaces;
+    };
+
+    std::string _getKey(const std::string& pName, size_t pIndex, size_t pTotal) const;
+
+    std::string  mBase;
+    std::string  mCompressionSuffix;
+    ShardOptions mOptions;
+
+    std::vector<Shard> mShards;
+};
+
+METADUMPER_OUTPUT_END
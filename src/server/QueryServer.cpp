@@ -0,0 +1,324 @@
+#include "QueryServer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using JSON = nlohmann::json;
+
+METADUMPER_SERVER_BEGIN
+
+namespace {
+
+// https://www.jsonrpc.org/specification#error_object
+enum ErrorCode {
+    ParseError     = -32700,
+    InvalidRequest = -32600,
+    MethodNotFound = -32601,
+    InvalidParams  = -32602,
+    InternalError  = -32603,
+};
+
+// A connection sending more than this without a newline is answered with an error and closed.
+constexpr size_t MAX_LINE_LENGTH = 1024 * 1024;
+
+struct RpcError : public std::runtime_error {
+    RpcError(ErrorCode pCode, const std::string& pMessage) : std::runtime_error(pMessage), mCode(pCode) {}
+    ErrorCode mCode;
+};
+
+std::string require_string(const JSON& pParams, const char* pKey) {
+    if (!pParams.is_object() || !pParams.contains(pKey) || !pParams[pKey].is_string())
+        throw RpcError(InvalidParams, fmt::format("Missing string parameter '{}'.", pKey));
+    return pParams[pKey].get<std::string>();
+}
+
+// Addresses may be given as numbers or as (hex) strings, e.g. "0x1234".
+uintptr_t require_address(const JSON& pParams, const char* pKey) {
+    if (pParams.is_object() && pParams.contains(pKey)) {
+        auto& value = pParams[pKey];
+        if (value.is_number_unsigned()) return value.get<uintptr_t>();
+        if (value.is_string()) {
+            try {
+                return std::stoull(value.get<std::string>(), nullptr, 0);
+            } catch (const std::exception&) {}
+        }
+    }
+    throw RpcError(InvalidParams, fmt::format("Missing address parameter '{}'.", pKey));
+}
+
+// Invalid UTF-8 in the message is replaced, this never throws a type_error.
+std::string error_response(ErrorCode pCode, const std::string& pMessage, const JSON& pId = {}) {
+    return JSON{
+        {"jsonrpc", "2.0"                                         },
+        {"error",   JSON{{"code", pCode}, {"message", pMessage}}},
+        {"id",      pId                                           }
+    }.dump(-1, ' ', false, JSON::error_handler_t::replace);
+}
+
+JSON slots_to_json(const abi::itanium::SlotIndex& pIndex, std::span<const abi::itanium::SlotIndex::Slot> pSlots) {
+    auto ret = JSON::array();
+    for (auto& slot : pSlots) {
+        ret.emplace_back(JSON{
+            {"vtable", pIndex.getVTableName(slot.mVTable)},
+            {"offset", slot.mOffset                      },
+            {"index",  slot.mSlot                        }
+        });
+    }
+    return ret;
+}
+
+} // namespace
+
+QueryServer::QueryServer(abi::itanium::DumpVFTableResult pVFTable, abi::itanium::DumpTypeInfoResult pTypeInfo)
+: mVFTable(std::move(pVFTable)),
+  mTypeInfo(std::move(pTypeInfo)) {
+    _buildIndexes();
+}
+
+void QueryServer::_buildIndexes() {
+    auto& vftables = mVFTable.mVFTable;
+    mVTableByName.reserve(vftables.size());
+    for (size_t idx = 0; idx < vftables.size(); idx++) {
+        auto& vtable = vftables[idx];
+        mVTableByName.try_emplace(vtable.mName, idx);
+        mSlots.add(vtable);
+    }
+    mSlots.build();
+
+    spdlog::info(
+        "Query server ready: {} vtable(s), {} typeinfo(s), {} slot(s) indexed.",
+        mVTableByName.size(),
+        mTypeInfo.mTypeInfo.size(),
+        mSlots.size()
+    );
+}
+
+std::optional<std::string> QueryServer::handle(const std::string& pRequest) const {
+    JSON        id;
+    ErrorCode   code{InternalError};
+    std::string message;
+    bool        notification = false;
+    try {
+        auto request = JSON::parse(pRequest, nullptr, false);
+        if (request.is_discarded()) throw RpcError(ParseError, "Parse error.");
+        if (!request.is_object() || !request.contains("method") || !request["method"].is_string())
+            throw RpcError(InvalidRequest, "Invalid request.");
+        notification = !request.contains("id");
+        if (!notification) id = request["id"];
+        auto result =
+            _dispatch(request["method"].get<std::string>(), request.contains("params") ? request["params"] : JSON{});
+        if (notification) return std::nullopt;
+        // Dumped here, e.g. symbol names that are not valid UTF-8 throw.
+        return JSON{
+            {"jsonrpc", "2.0"            },
+            {"result",  std::move(result)},
+            {"id",      id               }
+        }.dump();
+    } catch (const RpcError& e) {
+        code    = e.mCode;
+        message = e.what();
+    } catch (const std::exception& e) {
+        code    = InternalError;
+        message = e.what();
+    }
+    if (notification) return std::nullopt;
+    return error_response(code, message, id);
+}
+
+JSON QueryServer::_dispatch(const std::string& pMethod, const JSON& pParams) const {
+    if (pMethod == "vtable.get") return _getVTable(pParams);
+    if (pMethod == "vtable.slot") return _getSlot(pParams);
+    if (pMethod == "typeinfo.get") return _getTypeInfo(pParams);
+    if (pMethod == "rva.lookup") return _lookupRVA(pParams);
+    if (pMethod == "symbol.lookup") return _lookupSymbol(pParams);
+    if (pMethod == "stats") return _getStats();
+    throw RpcError(MethodNotFound, fmt::format("Method '{}' not found.", pMethod));
+}
+
+const abi::itanium::VTable* QueryServer::_findVTable(const JSON& pParams) const {
+    auto it = mVTableByName.find(require_string(pParams, "name"));
+    if (it == mVTableByName.end()) return nullptr;
+    return &mVFTable.mVFTable[it->second];
+}
+
+JSON QueryServer::_getVTable(const JSON& pParams) const {
+    auto vtable = _findVTable(pParams);
+    return vtable ? vtable->toJson() : JSON{};
+}
+
+JSON QueryServer::_getSlot(const JSON& pParams) const {
+    auto vtable = _findVTable(pParams);
+    if (!vtable) return {};
+    if (!pParams.contains("index") || !pParams["index"].is_number_unsigned())
+        throw RpcError(InvalidParams, "Missing unsigned parameter 'index'.");
+    auto      index  = pParams["index"].get<size_t>();
+    ptrdiff_t offset = 0;
+    if (pParams.contains("offset")) {
+        if (!pParams["offset"].is_number_integer())
+            throw RpcError(InvalidParams, "Parameter 'offset' must be integer.");
+        offset = pParams["offset"].get<ptrdiff_t>();
+    }
+    auto subTable = vtable->mSubTables.find(offset);
+    if (subTable == vtable->mSubTables.end() || index >= subTable->second.size()) return {};
+    return subTable->second[index].toJson();
+}
+
+JSON QueryServer::_getTypeInfo(const JSON& pParams) const {
+    auto& types = mTypeInfo.mTypeInfo;
+    auto  idx   = types.find(require_string(pParams, "name"));
+    return idx != abi::itanium::TypeInfoTable::INVALID ? types.toJson(types[idx]) : JSON{};
+}
+
+JSON QueryServer::_lookupRVA(const JSON& pParams) const {
+    return slots_to_json(mSlots, mSlots.lookup(require_address(pParams, "rva")));
+}
+
+JSON QueryServer::_lookupSymbol(const JSON& pParams) const {
+    return slots_to_json(mSlots, mSlots.lookup(require_string(pParams, "symbol")));
+}
+
+JSON QueryServer::_getStats() const {
+    return JSON{
+        {"vtables",   mVTableByName.size()      },
+        {"typeinfos", mTypeInfo.mTypeInfo.size()},
+        {"slots",     mSlots.size()             }
+    };
+}
+
+void QueryServer::serveStdio() {
+    std::ios::sync_with_stdio(false);
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+        if (auto response = handle(line)) std::cout << *response << '\n' << std::flush;
+    }
+}
+
+#ifndef _WIN32
+
+bool QueryServer::serveUnixSocket(const std::string& pPath) {
+    sockaddr_un addr{};
+    if (pPath.size() >= sizeof(addr.sun_path)) {
+        spdlog::error("Socket path is too long: {}", pPath);
+        return false;
+    }
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        spdlog::error("Failed to create socket.");
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, pPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(pPath.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        spdlog::error("Failed to listen on {}.", pPath);
+        close(fd);
+        return false;
+    }
+    spdlog::info("Listening on {}", pPath);
+
+    // Joined before returning, they use this server. Finished ones are reaped on the next accept. The fd is only
+    // closed once its thread is joined, so that shutdown() can't hit a reused descriptor.
+    struct Connection {
+        int                                mFd;
+        std::shared_ptr<std::atomic<bool>> mIsDone;
+        std::thread                        mThread;
+    };
+    std::list<Connection> connections;
+    auto                  reap = [&](bool pAll) {
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (!pAll && !*it->mIsDone) {
+                it++;
+                continue;
+            }
+            if (!*it->mIsDone) shutdown(it->mFd, SHUT_RDWR); // wakes up recv().
+            it->mThread.join();
+            close(it->mFd);
+            it = connections.erase(it);
+        }
+    };
+
+    bool succeed = true;
+    while (true) {
+        auto conn = accept(fd, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            spdlog::error("Failed to accept connection: {}", std::strerror(errno));
+            succeed = false;
+            break;
+        }
+        reap(false);
+        auto  isDone     = std::make_shared<std::atomic<bool>>(false);
+        auto& connection = connections.emplace_back(Connection{conn, isDone, {}});
+        connection.mThread = std::thread([this, conn, isDone] {
+            _serveConnection(conn);
+            shutdown(conn, SHUT_RDWR); // the peer sees the end, the fd is closed when reaped.
+            *isDone = true;
+        });
+    }
+    reap(true);
+    close(fd);
+    unlink(pPath.c_str());
+    return succeed;
+}
+
+namespace {
+
+bool send_line(int pFd, std::string pLine) {
+    pLine += '\n';
+    for (size_t sent = 0; sent < pLine.size();) {
+        auto ret = send(pFd, pLine.data() + sent, pLine.size() - sent, MSG_NOSIGNAL);
+        if (ret <= 0) return false;
+        sent += ret;
+    }
+    return true;
+}
+
+} // namespace
+
+void QueryServer::_serveConnection(int pFd) const {
+    std::string buffer;
+    char        chunk[4096];
+    while (true) {
+        auto size = recv(pFd, chunk, sizeof(chunk), 0);
+        if (size <= 0) return;
+        buffer.append(chunk, size);
+        size_t begin = 0;
+        for (auto end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', begin)) {
+            auto line = buffer.substr(begin, end - begin);
+            begin     = end + 1;
+            if (line.empty()) continue;
+            auto response = handle(line);
+            if (response && !send_line(pFd, std::move(*response))) return;
+        }
+        buffer.erase(0, begin);
+        if (buffer.size() > MAX_LINE_LENGTH) {
+            send_line(pFd, error_response(InvalidRequest, "Request line too long."));
+            return;
+        }
+    }
+}
+
+#else
+
+bool QueryServer::serveUnixSocket(const std::string& pPath) {
+    spdlog::error("Unix socket is not supported on this platform.");
+    return false;
+}
+
+void QueryServer::_serveConnection(int pFd) const {}
+
+#endif
+
+METADUMPER_SERVER_END
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "abi/itanium/ItaniumSlotIndex.h"
+#include "abi/itanium/ItaniumVTableReader.h"
+
+#include <nlohmann/json.hpp>
+
+#include <optional>
+
+METADUMPER_SERVER_BEGIN
+
+// Keeps the dump results of one image in memory and answers JSON-RPC 2.0 requests about them.
+// All indexes are built once in the constructor and never modified afterwards, so any number of
+// connections can query them concurrently without locking.
+class QueryServer {
+public:
+    QueryServer(abi::itanium::DumpVFTableResult pVFTable, abi::itanium::DumpTypeInfoResult pTypeInfo);
+
+    // One request per line on stdin, one response per line on stdout.
+    void serveStdio();
+
+    // One thread per accepted connection, same line-delimited protocol as serveStdio(). Lines are limited to 1 MiB.
+    // Returns false if the socket can't be set up or accepting fails; open connections are closed and joined first.
+    bool serveUnixSocket(const std::string& pPath);
+
+    // Handles a single request line, returns the response line (without '\n'), or nullopt for a notification (a valid
+    // request without "id"). Failures, e.g. results that are not valid UTF-8, are answered with an internal error.
+    std::optional<std::string> handle(const std::string& pRequest) const;
+
+private:
+    void _buildIndexes();
+    // Until the peer closes, a send fails or a line is too long. Doesn't close pFd.
+    void _serveConnection(int pFd) const;
+
+    nlohmann::json _dispatch(const std::string& pMethod, const nlohmann::json& pParams) const;
+
+    nlohmann::json _getVTable(const nlohmann::json& pParams) const;
+    nlohmann::json _getSlot(const nlohmann::json& pParams) const;
+    nlohmann::json _getTypeInfo(const nlohmann::json& pParams) const;
+    nlohmann::json _lookupRVA(const nlohmann::json& pParams) const;
+    nlohmann::json _lookupSymbol(const nlohmann::json& pParams) const;
+    nlohmann::json _getStats() const;
+
+    const abi::itanium::VTable* _findVTable(const nlohmann::json& pParams) const;
+
+    abi::itanium::DumpVFTableResult  mVFTable;
+    abi::itanium::DumpTypeInfoResult mTypeInfo;
+
+    std::unordered_map<std::string, size_t> mVTableByName;
+    abi::itanium::SlotIndex                 mSlots;
+};
+
+METADUMPER_SERVER_END
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+METADUMPER_UTIL_BEGIN
+
+// Sorted flat array of (address, size, symbol-id), replaces unordered_map<uintptr_t, Symbol*> on the address path.
+// Entries are 16 bytes and contiguous, lookups are a branchless binary search.
+template <typename Symbol>
+class AddressIndex {
+public:
+    void reserve(size_t pSize) {
+        mEntries.reserve(pSize);
+        mSymbols.reserve(pSize);
+    }
+
+    // Call build() after all entries are added.
+    void add(uintptr_t pAddress, size_t pSize, Symbol* pSymbol) {
+        auto size = (uint32_t)std::min<size_t>(pSize, UINT32_MAX);
+        mEntries.emplace_back(Entry{pAddress, size, (uint32_t)mSymbols.size()});
+        mSymbols.emplace_back(pSymbol);
+    }
+
+    // For duplicate addresses, the symbol added first wins (same as try_emplace), but the largest size is kept.
+    // With pInferSizes, entries without size extend to the next address (e.g. Mach-O nlist has no size).
+    void build(bool pInferSizes = false) {
+        parallelStableSort(mEntries, [](const Entry& pLhs, const Entry& pRhs) {
+            return pLhs.mAddress < pRhs.mAddress;
+        });
+        size_t size = 0;
+        for (auto& entry : mEntries) {
+            if (size && mEntries[size - 1].mAddress == entry.mAddress) {
+                mEntries[size - 1].mSize = std::max(mEntries[size - 1].mSize, entry.mSize);
+                continue;
+            }
+            mEntries[size++] = entry;
+        }
+        mEntries.resize(size);
+        mEntries.shrink_to_fit();
+        std::vector<Symbol*> symbols;
+        symbols.reserve(size);
+        for (auto& entry : mEntries) {
+            symbols.emplace_back(mSymbols[entry.mSymbol]);
+            entry.mSymbol = (uint32_t)(symbols.size() - 1);
+        }
+        mSymbols = std::move(symbols);
+        if (pInferSizes) {
+            for (size_t idx = 0; idx + 1 < mEntries.size(); idx++) {
+                if (mEntries[idx].mSize || !mEntries[idx].mAddress) continue; // 0 is where undefined ones live.
+                mEntries[idx].mSize =
+                    (uint32_t)std::min<uintptr_t>(mEntries[idx + 1].mAddress - mEntries[idx].mAddress, UINT32_MAX);
+            }
+        }
+        // Entries in between a parent and its child end before the child starts, so they can't cover anything past it.
+        mParents.assign(mEntries.size(), NO_PARENT);
+        for (size_t idx = 1; idx < mEntries.size(); idx++) {
+            auto parent = (uint32_t)(idx - 1);
+            while (parent != NO_PARENT && _getEnd(mEntries[parent]) <= mEntries[idx].mAddress) {
+                parent = mParents[parent];
+            }
+            mParents[idx] = parent;
+        }
+    }
+
+    [[nodiscard]] Symbol* lookup(uintptr_t pAddress) const {
+        auto entry = _floor(pAddress);
+        return entry && entry->mAddress == pAddress ? mSymbols[entry->mSymbol] : nullptr;
+    }
+
+    // Innermost symbol whose [address, address + size) contains pAddress, pOffset receives the distance to its start.
+    // Smaller symbols inside a larger one (local labels, nested objects) don't hide it past their own end.
+    [[nodiscard]] Symbol* lookupContaining(uintptr_t pAddress, size_t& pOffset) const {
+        auto entry = _floor(pAddress);
+        if (!entry) return nullptr;
+        auto idx = (uint32_t)(entry - mEntries.data());
+        while (idx != NO_PARENT && mEntries[idx].mAddress != pAddress && _getEnd(mEntries[idx]) <= pAddress) {
+            idx = mParents[idx];
+        }
+        if (idx == NO_PARENT) return nullptr;
+        pOffset = pAddress - mEntries[idx].mAddress;
+        return mSymbols[mEntries[idx].mSymbol];
+    }
+
+    [[nodiscard]] size_t size() const { return mEntries.size(); }
+
+private:
+    struct Entry {
+        uintptr_t mAddress;
+        uint32_t  mSize;
+        uint32_t  mSymbol; // index of mSymbols
+    };
+
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    static uintptr_t _getEnd(const Entry& pEntry) { return pEntry.mAddress + pEntry.mSize; }
+
+    // Last entry with mAddress <= pAddress.
+    const Entry* _floor(uintptr_t pAddress) const {
+        if (mEntries.empty() || mEntries.front().mAddress > pAddress) return nullptr;
+        auto   base = mEntries.data();
+        size_t len  = mEntries.size();
+        while (len > 1) {
+            auto half  = len / 2;
+            base      += (base[half].mAddress <= pAddress) ? half : 0; // cmov
+            len       -= half;
+        }
+        return base;
+    }
+
+    std::vector<Entry>    mEntries;
+    std::vector<Symbol*>  mSymbols;
+    std::vector<uint32_t> mParents; // nearest previous entry covering the start of each one, or NO_PARENT.
+};
+
+METADUMPER_UTIL_END
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "util/Parallel.h"
+
+#include <array>
+#include <optional>
+#include <unordered_set>
+
+METADUMPER_UTIL_BEGIN
+
+// Set of addresses split into SHARDS by hash, as NameMap does for names, so that build() fills every shard on its own
+// thread. Iterates shard by shard.
+class AddressSet {
+public:
+    static constexpr size_t SHARDS = 64;
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = uintptr_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const uintptr_t*;
+        using reference         = const uintptr_t&;
+
+        Iterator() = default;
+
+        reference operator*() const { return *mIt; }
+        pointer   operator->() const { return &*mIt; }
+
+        Iterator& operator++() {
+            ++mIt;
+            _skipEmpty();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const Iterator& pOther) const {
+            return mShard == pOther.mShard && (mShard == SHARDS || mIt == pOther.mIt);
+        }
+
+    private:
+        friend class AddressSet;
+
+        Iterator(const AddressSet* pSet, size_t pShard) : mSet(pSet), mShard(pShard) {
+            if (mShard < SHARDS) mIt = mSet->mShards[mShard].begin();
+            _skipEmpty();
+        }
+
+        void _skipEmpty() {
+            while (mShard < SHARDS && mIt == mSet->mShards[mShard].end()) {
+                if (++mShard < SHARDS) mIt = mSet->mShards[mShard].begin();
+            }
+        }
+
+        const AddressSet*                             mSet{};
+        size_t                                        mShard{SHARDS};
+        std::unordered_set<uintptr_t>::const_iterator mIt;
+    };
+
+    // Adds pValue(idx) for every idx in [0, pCount) it is not nullopt for. Chunks are classified in parallel, then
+    // every shard is filled from the chunks in order.
+    template <typename Value>
+    void build(size_t pCount, Value&& pValue) {
+        std::vector<std::array<std::vector<uintptr_t>, SHARDS>> chunks(getChunkCount(pCount));
+        parallelForChunks(pCount, [&](size_t pChunk, size_t pBegin, size_t pEnd) {
+            for (auto idx = pBegin; idx < pEnd; idx++) {
+                std::optional<uintptr_t> value = pValue(idx);
+                if (value) chunks[pChunk][_getShard(*value)].emplace_back(*value);
+            }
+        });
+        parallelFor(SHARDS, [&](size_t pShard) {
+            auto&  shard = mShards[pShard];
+            size_t size  = shard.size();
+            for (auto& chunk : chunks) size += chunk[pShard].size();
+            shard.reserve(size);
+            for (auto& chunk : chunks) shard.insert(chunk[pShard].begin(), chunk[pShard].end());
+        });
+    }
+
+    bool emplace(uintptr_t pAddress) { return mShards[_getShard(pAddress)].emplace(pAddress).second; }
+
+    [[nodiscard]] bool contains(uintptr_t pAddress) const { return mShards[_getShard(pAddress)].contains(pAddress); }
+
+    [[nodiscard]] size_t size() const {
+        size_t ret = 0;
+        for (auto& shard : mShards) ret += shard.size();
+        return ret;
+    }
+
+    [[nodiscard]] bool empty() const { return begin() == end(); }
+
+    [[nodiscard]] Iterator begin() const { return {this, 0}; }
+    [[nodiscard]] Iterator end() const { return {}; }
+
+private:
+    // Addresses are aligned, so the top bits of a multiplicative hash rather than the low ones.
+    static size_t _getShard(uintptr_t pAddress) {
+        return (size_t)(((uint64_t)pAddress * 0x9e3779b97f4a7c15ull) >> 58) % SHARDS;
+    }
+
+    std::array<std::unordered_set<uintptr_t>, SHARDS> mShards;
+};
+
+METADUMPER_UTIL_END
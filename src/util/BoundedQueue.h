@@ -0,0 +1,57 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+METADUMPER_UTIL_BEGIN
+
+// Blocking multi-producer/multi-consumer queue with a fixed capacity, producers wait while it is full.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t pCapacity) : mCapacity(std::max<size_t>(pCapacity, 1)) {}
+
+    // Returns false if the queue is already closed.
+    bool push(T pValue) {
+        std::unique_lock lock(mMutex);
+        mNotFull.wait(lock, [this] { return mIsClosed || mItems.size() < mCapacity; });
+        if (mIsClosed) return false;
+        mItems.emplace_back(std::move(pValue));
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    // Returns nullopt once the queue is closed and drained.
+    std::optional<T> pop() {
+        std::unique_lock lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return mIsClosed || !mItems.empty(); });
+        if (mItems.empty()) return std::nullopt;
+        auto ret = std::move(mItems.front());
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return ret;
+    }
+
+    // No more pushes, pending items are still popped.
+    void close() {
+        std::lock_guard lock(mMutex);
+        mIsClosed = true;
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+private:
+    size_t                  mCapacity;
+    bool                    mIsClosed{};
+    std::deque<T>           mItems;
+    std::mutex              mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+};
+
+METADUMPER_UTIL_END
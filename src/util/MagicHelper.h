@@ -1,7 +1,9 @@
 #pragma once
 
 #include "base/Base.h"
-#include "base/Loader.h"
+#include "base/MappedFile.h"
+
+#include <cstring>
 
 METADUMPER_BEGIN
 
@@ -13,23 +15,31 @@ enum class Magic {
     MACHO_64,
 };
 
-class MagicHelper : public Loader {
+class MagicHelper {
 public:
-    using Loader::Loader;
+    explicit MagicHelper(const MappedFile& pFile) : mFile(pFile) {}
 
-    Magic judgeFileType() {
-        auto magic = read<uint32_t>(); // read 4 bytes
+    Magic judgeFileType() const {
+        uint32_t magic{};
+        auto     bytes = mFile.bytes();
+        if (bytes.size() < sizeof(magic)) return Magic::UNKNOWN;
+        std::memcpy(&magic, bytes.data(), sizeof(magic)); // read 4 bytes
         switch (magic) {
         case 0x464c457f:
             return Magic::ELF;
         case 0xfeedface:
+        case 0xcefaedfe:
             return Magic::MACHO_32;
         case 0xfeedfacf:
+        case 0xcffaedfe:
             return Magic::MACHO_64;
         }
         if ((magic & 0xffff) == 0x5a4d) return Magic::PE;
         return Magic::UNKNOWN;
     };
+
+private:
+    const MappedFile& mFile;
 };
 
 METADUMPER_END
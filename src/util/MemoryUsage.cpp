@@ -0,0 +1,27 @@
+#include "MemoryUsage.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+METADUMPER_UTIL_BEGIN
+
+#ifndef _WIN32
+
+std::optional<size_t> getPeakResidentSize() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return std::nullopt;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss; // bytes
+#else
+    return (size_t)usage.ru_maxrss * 1024; // KiB
+#endif
+}
+
+#else
+
+std::optional<size_t> getPeakResidentSize() { return std::nullopt; }
+
+#endif
+
+METADUMPER_UTIL_END
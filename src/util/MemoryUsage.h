@@ -0,0 +1,12 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <optional>
+
+METADUMPER_UTIL_BEGIN
+
+// Peak resident set size of this process so far, in bytes (getrusage). nullopt where it is not supported.
+std::optional<size_t> getPeakResidentSize();
+
+METADUMPER_UTIL_END
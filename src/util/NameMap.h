@@ -0,0 +1,57 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "util/Parallel.h"
+
+#include <array>
+#include <string_view>
+#include <unordered_map>
+
+METADUMPER_UTIL_BEGIN
+
+// Name -> value, as an unordered_map split into SHARDS by hash, so that build() fills every shard on its own thread.
+// Names are not copied, they must outlive the map, e.g. the names of LIEF's symbols.
+template <typename T>
+class NameMap {
+public:
+    static constexpr size_t SHARDS = 64;
+
+    // Same content as try_emplace(pName(idx), pValue(idx)) for idx in [0, pCount) in order: the first of duplicate
+    // names wins. Chunks of names are hashed in parallel, then every shard is filled from the chunks in order.
+    template <typename Name, typename Value>
+    void build(size_t pCount, Name&& pName, Value&& pValue) {
+        std::vector<std::array<std::vector<uint32_t>, SHARDS>> chunks(getChunkCount(pCount));
+        parallelForChunks(pCount, [&](size_t pChunk, size_t pBegin, size_t pEnd) {
+            for (auto idx = pBegin; idx < pEnd; idx++) chunks[pChunk][_getShard(pName(idx))].emplace_back(idx);
+        });
+        parallelFor(SHARDS, [&](size_t pShard) {
+            auto&  shard = mShards[pShard];
+            size_t size  = shard.size();
+            for (auto& chunk : chunks) size += chunk[pShard].size();
+            shard.reserve(size);
+            for (auto& chunk : chunks) {
+                for (auto idx : chunk[pShard]) shard.try_emplace(std::string_view(pName(idx)), pValue(idx));
+            }
+        });
+    }
+
+    [[nodiscard]] const T* find(std::string_view pName) const {
+        auto& shard = mShards[_getShard(pName)];
+        auto  it    = shard.find(pName);
+        return it == shard.end() ? nullptr : &it->second;
+    }
+
+    [[nodiscard]] size_t size() const {
+        size_t ret = 0;
+        for (auto& shard : mShards) ret += shard.size();
+        return ret;
+    }
+
+private:
+    static size_t _getShard(std::string_view pName) { return std::hash<std::string_view>{}(pName) % SHARDS; }
+
+    std::array<std::unordered_map<std::string_view, T>, SHARDS> mShards;
+};
+
+METADUMPER_UTIL_END
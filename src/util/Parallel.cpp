@@ -0,0 +1,53 @@
+#include "Parallel.h"
+
+METADUMPER_UTIL_BEGIN
+
+ThreadPool& ThreadPool::get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mMutex);
+        mIsStopping = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers) worker.join();
+}
+
+void ThreadPool::run(const std::function<void()>& pWork, unsigned int pHelpers) {
+    if (!pHelpers) return pWork();
+    Job job{&pWork, pHelpers, 0};
+    {
+        std::lock_guard lock(mMutex);
+        // Grown on demand, e.g. for more threads than cores.
+        while (mWorkers.size() < pHelpers) mWorkers.emplace_back([this]() { _work(); });
+        mJobs.emplace_back(&job);
+    }
+    mWake.notify_all();
+
+    pWork();
+
+    std::unique_lock lock(mMutex);
+    // Every index is taken by now, helpers that did not start are not needed anymore.
+    if (job.mHelpers) mJobs.erase(std::find(mJobs.begin(), mJobs.end(), &job));
+    mFinished.wait(lock, [&]() { return job.mRunning == 0; });
+}
+
+void ThreadPool::_work() {
+    std::unique_lock lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [&]() { return mIsStopping || !mJobs.empty(); });
+        if (mIsStopping) return;
+        auto job = mJobs.front();
+        if (--job->mHelpers == 0) mJobs.pop_front();
+        job->mRunning++;
+        lock.unlock();
+        (*job->mWork)();
+        lock.lock();
+        if (--job->mRunning == 0) mFinished.notify_all();
+    }
+}
+
+METADUMPER_UTIL_END
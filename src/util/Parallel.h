@@ -0,0 +1,94 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+METADUMPER_UTIL_BEGIN
+
+// Symbols per chunk of parallel ingestion, large enough to amortize the scheduling.
+constexpr size_t INGEST_CHUNK_SIZE = 64 * 1024;
+
+inline size_t getChunkCount(size_t pCount, size_t pChunkSize = INGEST_CHUNK_SIZE) {
+    return (pCount + pChunkSize - 1) / pChunkSize;
+}
+
+// Worker threads shared by every parallelFor(), started on first use and kept until exit: the calls come back to back
+// (symbol ingestion, sorts, merges), and spawning threads for each cost more than the smaller ones took.
+class ThreadPool {
+public:
+    static ThreadPool& get();
+
+    ~ThreadPool();
+
+    // Runs pWork on the calling thread and on up to pHelpers idle workers, returns once every run has returned. The
+    // caller works too, so a job always completes, nested ones included, even when every worker is busy.
+    void run(const std::function<void()>& pWork, unsigned int pHelpers);
+
+private:
+    struct Job {
+        const std::function<void()>* mWork;
+        unsigned int                 mHelpers; // still wanted.
+        unsigned int                 mRunning; // helpers that have not returned yet.
+    };
+
+    void _work();
+
+    std::mutex               mMutex;
+    std::condition_variable  mWake;     // jobs queued, or stopping.
+    std::condition_variable  mFinished; // a helper returned.
+    std::deque<Job*>         mJobs;
+    std::vector<std::thread> mWorkers;
+    bool                     mIsStopping{};
+};
+
+// Calls pBody(idx) for every idx in [0, pCount), on up to pThreads threads (0 = hardware concurrency), the calling one
+// included. Bodies must not log, the default logger is single-threaded.
+template <typename Body>
+void parallelFor(size_t pCount, Body&& pBody, unsigned int pThreads = 0) {
+    if (!pThreads) pThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t>         next{};
+    const std::function<void()> worker = [&]() {
+        for (auto idx = next++; idx < pCount; idx = next++) pBody(idx);
+    };
+    if (pCount <= 1 || pThreads == 1) return worker();
+    ThreadPool::get().run(worker, (unsigned int)std::min<size_t>(pThreads, pCount) - 1);
+}
+
+// Calls pBody(chunk, begin, end) for every chunk of [0, pCount), in parallel.
+template <typename Body>
+void parallelForChunks(size_t pCount, Body&& pBody, size_t pChunkSize = INGEST_CHUNK_SIZE) {
+    parallelFor(getChunkCount(pCount, pChunkSize), [&](size_t pChunk) {
+        pBody(pChunk, pChunk * pChunkSize, std::min(pCount, (pChunk + 1) * pChunkSize));
+    });
+}
+
+// Same result as std::stable_sort: chunks are sorted in parallel, then merged pairwise, left first.
+template <typename T, typename Compare>
+void parallelStableSort(std::vector<T>& pItems, Compare pCompare, size_t pChunkSize = INGEST_CHUNK_SIZE) {
+    auto count = pItems.size();
+    parallelForChunks(
+        count,
+        [&](size_t, size_t pBegin, size_t pEnd) {
+            std::stable_sort(pItems.begin() + pBegin, pItems.begin() + pEnd, pCompare);
+        },
+        pChunkSize
+    );
+    for (auto width = pChunkSize; width < count; width *= 2) {
+        parallelFor(getChunkCount(count, 2 * width), [&](size_t pPair) {
+            auto begin  = pPair * 2 * width;
+            auto middle = std::min(count, begin + width);
+            auto end    = std::min(count, begin + 2 * width);
+            std::inplace_merge(pItems.begin() + begin, pItems.begin() + middle, pItems.begin() + end, pCompare);
+        });
+    }
+}
+
+METADUMPER_UTIL_END
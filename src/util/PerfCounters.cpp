@@ -0,0 +1,123 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+METADUMPER_UTIL_BEGIN
+
+#ifdef __linux__
+
+namespace {
+
+struct EventConfig {
+    uint32_t mType;
+    uint64_t mConfig;
+};
+
+constexpr EventConfig EVENTS[PerfCounters::EventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES   },
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }, // last level
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS  },
+};
+
+int open_event(const EventConfig& pEvent, int pGroup) {
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = pEvent.mType;
+    attr.config         = pEvent.mConfig;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit        = 1; // worker threads, e.g. symbol ingestion and compression.
+    attr.exclude_kernel = 1; // allowed up to perf_event_paranoid 2.
+    attr.exclude_hv     = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, pGroup, PERF_FLAG_FD_CLOEXEC);
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    mFds.fill(-1);
+    int group = -1, error = 0;
+    for (int idx = 0; idx < EventCount; idx++) {
+        mFds[idx] = open_event(EVENTS[idx], group);
+        if (mFds[idx] < 0) {
+            error = errno;
+            spdlog::debug("Perf counter {} is not available: {}", getEventName((Event)idx), strerror(error));
+            continue;
+        }
+        if (group < 0) group = mFds[idx];
+    }
+    if (isValid()) return;
+    if (error == EACCES || error == EPERM) {
+        spdlog::warn("Perf counters are not permitted, see /proc/sys/kernel/perf_event_paranoid.");
+    } else {
+        spdlog::warn("Perf counters are not available: {}", strerror(error));
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (auto fd : mFds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool PerfCounters::isValid() const {
+    for (auto fd : mFds) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+PerfCounters::Sample PerfCounters::read() const {
+    Sample ret;
+    for (int idx = 0; idx < EventCount; idx++) {
+        if (mFds[idx] < 0) continue;
+        uint64_t values[3]; // value, time enabled, time running
+        if (::read(mFds[idx], values, sizeof(values)) != sizeof(values) || !values[2]) continue;
+        // Multiplexed with other users of the PMU, extrapolated.
+        ret[idx] = values[2] < values[1] ? (uint64_t)((double)values[0] * (double)values[1] / (double)values[2])
+                                         : values[0];
+    }
+    return ret;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    mFds.fill(-1);
+    spdlog::warn("Perf counters are only supported on Linux.");
+}
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::isValid() const { return false; }
+
+PerfCounters::Sample PerfCounters::read() const { return {}; }
+
+#endif
+
+std::string_view PerfCounters::getEventName(Event pEvent) {
+    switch (pEvent) {
+    case Cycles:
+        return "cycles";
+    case Instructions:
+        return "instructions";
+    case CacheMisses:
+        return "llc_misses";
+    case BranchMisses:
+        return "branch_misses";
+    case PageFaults:
+        return "page_faults";
+    default:
+        return "unknown";
+    }
+}
+
+METADUMPER_UTIL_END
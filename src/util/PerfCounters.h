@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include <array>
+#include <optional>
+
+METADUMPER_UTIL_BEGIN
+
+// Hardware and software counters of this process through perf_event_open (Linux only), threads started later included.
+// Events are opened as one group, so they are scheduled together; any event the kernel or the CPU refuses is left
+// out, and without any event the counters are simply not valid. Values are scaled if the events were multiplexed.
+class PerfCounters {
+public:
+    enum Event { Cycles, Instructions, CacheMisses, BranchMisses, PageFaults, EventCount };
+
+    // Per event, nullopt if it is not counted.
+    using Sample = std::array<std::optional<uint64_t>, EventCount>;
+
+    // Counting starts right away. Logs why if nothing can be counted.
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool isValid() const;
+
+    [[nodiscard]] Sample read() const;
+
+    // e.g. "cycles", "llc_misses", as in the stats report.
+    static std::string_view getEventName(Event pEvent);
+
+private:
+    std::array<int, EventCount> mFds; // -1 if not counted.
+};
+
+METADUMPER_UTIL_END
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "base/Base.h"
+
+#include "util/PerfCounters.h"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <map>
+
+METADUMPER_UTIL_BEGIN
+
+// Wall time of the consecutive phases of a run, plus a few counters, reported with --stats. With perf counters enabled
+// (--perf-counters), every phase also gets the hardware events it caused.
+class PhaseStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // For the following phases, returns false if no counter can be opened.
+    bool enablePerfCounters() {
+        auto counters = std::make_unique<PerfCounters>();
+        if (!counters->isValid()) return false;
+        mPerfCounters = std::move(counters);
+        return true;
+    }
+
+    // Ends the running phase, if any.
+    void begin(std::string pName) {
+        end();
+        mPhases.emplace_back(Phase{std::move(pName), Clock::now()});
+        // Last, so that the setup of the phase is not counted.
+        if (mPerfCounters) mPhases.back().mEvents = mPerfCounters->read();
+        mIsRunning = true;
+    }
+
+    void end() {
+        if (!mIsRunning) return;
+        auto& phase = mPhases.back();
+        // First, for the same reason.
+        if (mPerfCounters) {
+            auto events = mPerfCounters->read();
+            for (size_t idx = 0; idx < events.size(); idx++) {
+                auto& event = phase.mEvents[idx];
+                event       = event && events[idx] ? std::optional(*events[idx] - *event) : std::nullopt;
+            }
+        }
+        phase.mSeconds = std::chrono::duration<double>(Clock::now() - phase.mStart).count();
+        mIsRunning     = false;
+    }
+
+    void count(const std::string& pName, uint64_t pValue) { mCounters[pName] = pValue; }
+
+    [[nodiscard]] double getTotalSeconds() const {
+        double total = 0;
+        for (auto& phase : mPhases) total += phase.mSeconds;
+        return total;
+    }
+
+    // Rates use the "bytes" (input size) and "typeinfos" (one per polymorphic class) counters.
+    [[nodiscard]] nlohmann::json toJson() const {
+        auto phases = nlohmann::json::array();
+        for (auto& phase : mPhases) {
+            phases.emplace_back(nlohmann::json{
+                {"name",    phase.mName   },
+                {"seconds", phase.mSeconds}
+            });
+            if (mPerfCounters) phases.back()["events"] = _eventsToJson(phase.mEvents);
+        }
+        auto total = getTotalSeconds();
+        auto rate  = [&](const std::string& pCounter, double pUnit) -> nlohmann::json {
+            auto it = mCounters.find(pCounter);
+            if (it == mCounters.end() || total <= 0) return nullptr;
+            return (double)it->second / pUnit / total;
+        };
+        auto ret = nlohmann::json{
+            {"phases",             phases                        },
+            {"counters",           mCounters                     },
+            {"total_seconds",      total                         },
+            {"classes_per_second", rate("typeinfos", 1)          },
+            {"mb_per_second",      rate("bytes", 1024.0 * 1024.0)}
+        };
+        if (mPerfCounters) ret["events"] = _eventsToJson(_getTotalEvents());
+        return ret;
+    }
+
+    void print() const {
+        auto total = getTotalSeconds();
+        for (auto& phase : mPhases) {
+            spdlog::info(
+                "{:<12}{:>10.3f} ms ({:.1f}%)",
+                phase.mName + ":",
+                phase.mSeconds * 1000.0,
+                total > 0 ? phase.mSeconds / total * 100.0 : 0.0
+            );
+        }
+        spdlog::info("{:<12}{:>10.3f} ms", "Total:", total * 1000.0);
+        if (!mPerfCounters) return;
+        for (auto& phase : mPhases) spdlog::info("{:<12}{}", phase.mName + ":", _eventsToString(phase.mEvents));
+        spdlog::info("{:<12}{}", "Total:", _eventsToString(_getTotalEvents()));
+    }
+
+private:
+    struct Phase {
+        std::string          mName;
+        Clock::time_point    mStart;
+        double               mSeconds{};
+        PerfCounters::Sample mEvents{}; // at the start, then during the phase.
+    };
+
+    [[nodiscard]] PerfCounters::Sample _getTotalEvents() const {
+        PerfCounters::Sample ret{};
+        for (size_t idx = 0; idx < ret.size(); idx++) {
+            for (auto& phase : mPhases) {
+                if (phase.mEvents[idx]) ret[idx] = ret[idx].value_or(0) + *phase.mEvents[idx];
+            }
+        }
+        return ret;
+    }
+
+    static std::optional<double> _getIpc(const PerfCounters::Sample& pEvents) {
+        auto& cycles       = pEvents[PerfCounters::Cycles];
+        auto& instructions = pEvents[PerfCounters::Instructions];
+        if (!cycles || !instructions || !*cycles) return std::nullopt;
+        return (double)*instructions / (double)*cycles;
+    }
+
+    // Events that were not counted are null, "ipc" is instructions per cycle.
+    static nlohmann::json _eventsToJson(const PerfCounters::Sample& pEvents) {
+        auto ret = nlohmann::json::object();
+        for (size_t idx = 0; idx < pEvents.size(); idx++) {
+            auto name = std::string(PerfCounters::getEventName((PerfCounters::Event)idx));
+            ret[name] = pEvents[idx] ? nlohmann::json(*pEvents[idx]) : nlohmann::json(nullptr);
+        }
+        auto ipc   = _getIpc(pEvents);
+        ret["ipc"] = ipc ? nlohmann::json(*ipc) : nlohmann::json(nullptr);
+        return ret;
+    }
+
+    static std::string _eventsToString(const PerfCounters::Sample& pEvents) {
+        std::string ret;
+        for (size_t idx = 0; idx < pEvents.size(); idx++) {
+            if (!pEvents[idx]) continue;
+            if (!ret.empty()) ret += ", ";
+            ret += fmt::format("{} {}", PerfCounters::getEventName((PerfCounters::Event)idx), *pEvents[idx]);
+        }
+        if (auto ipc = _getIpc(pEvents)) ret += fmt::format(", ipc {:.2f}", *ipc);
+        return ret;
+    }
+
+    std::vector<Phase>              mPhases;
+    std::map<std::string, uint64_t> mCounters;
+    bool                            mIsRunning{};
+
+    std::unique_ptr<PerfCounters> mPerfCounters;
+};
+
+METADUMPER_UTIL_END
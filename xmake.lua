@@ -7,20 +7,54 @@ add_requires('spdlog          1.12.0')
 add_requires('argparse        2.9')
 add_requires('nlohmann_json   3.11.2')
 add_requires('magic_enum      0.9.6')
+add_requires('zstd            1.5.6')
+add_requires('zlib            1.3.1')
+add_requires('sqlite3')
 
 --- from: my-repo
 add_requires('lief            0.15.1')
 
+target('libcppmetadumper')
+    set_kind('$(kind)')
+    set_basename('cppmetadumper')
+    add_files('src/**.cpp|Main.cpp')
+    add_headerfiles('src/(**.h)')
+    add_includedirs('src', {public = true})
+    add_packages('spdlog', {public = true})
+    add_packages('nlohmann_json', {public = true})
+    add_packages('lief', {public = true})
+    add_packages('magic_enum')
+    add_packages('zstd')
+    add_packages('zlib')
+    add_packages('sqlite3')
+    set_warnings('all')
+    set_languages('cxx20', 'c99')
+    set_exceptions('cxx')
+    if is_kind('shared') then
+        add_rules('utils.symbols.export_all', {export_classes = true})
+    end
+
 target('cppmetadumper')
     set_kind('binary')
-    add_files('src/**.cpp')
-    add_headerfiles('src/**.h')
-    add_includedirs('src')
+    add_deps('libcppmetadumper')
+    add_files('src/Main.cpp')
     add_packages('spdlog')
     add_packages('argparse')
     add_packages('nlohmann_json')
     add_packages('lief')
-    add_packages('magic_enum')
+    set_warnings('all')
+    set_languages('cxx20', 'c99')
+    set_exceptions('cxx')
+
+target('cppmetadumper-bench')
+    set_kind('binary')
+    set_default(false)
+    add_deps('cppmetadumper')
+    add_files('bench/*.cpp')
+    add_includedirs('src')
+    add_packages('spdlog')
+    add_packages('argparse')
+    add_packages('nlohmann_json')
     set_warnings('all')
     set_languages('cxx20', 'c99')
     set_exceptions('cxx')